@@ -0,0 +1,276 @@
+﻿#include "KeyedArrayComponent.h"
+
+#include "Engine/World.h"
+#include "TimerManager.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+#include "KeyedArrayStoragePool.h"
+#include "UObject/UObjectIterator.h"
+
+void UKeyedArrayComponent::BindToKey(const FName Key, FKeyedArrayKeyChangedSignature Delegate)
+{
+	if (Delegate.IsBound())
+		KeyBindings.FindOrAdd(Key).AddUnique(Delegate);
+}
+
+void UKeyedArrayComponent::UnbindFromKey(const FName Key, FKeyedArrayKeyChangedSignature Delegate)
+{
+	TArray<FKeyedArrayKeyChangedSignature>* Bindings = KeyBindings.Find(Key);
+	if (!Bindings)
+		return;
+
+	Bindings->Remove(Delegate);
+	if (Bindings->Num() == 0)
+		KeyBindings.Remove(Key);
+}
+
+void UKeyedArrayComponent::UnbindAllFromKey(const FName Key)
+{
+	KeyBindings.Remove(Key);
+}
+
+void UKeyedArrayComponent::BeginBatch()
+{
+	BatchDepth++;
+}
+
+void UKeyedArrayComponent::EndBatch()
+{
+	if (BatchDepth <= 0)
+		return;
+
+	BatchDepth--;
+	if (BatchDepth == 0 && !BatchedChanges.IsEmpty())
+	{
+		const FKeyedArrayChangeSet ChangeSet = MoveTemp(BatchedChanges);
+		BatchedChanges.Reset();
+		FlushChanges(ChangeSet);
+	}
+}
+
+bool UKeyedArrayComponent::IsBatching() const
+{
+	return BatchDepth > 0;
+}
+
+bool UKeyedArrayComponent::IsFullySynced() const
+{
+	return bFullySynced || (GetOwner() && GetOwner()->HasAuthority());
+}
+
+const FKeyedArrayReplicationConditions& UKeyedArrayComponent::GetKeyConditions() const
+{
+	return KeyConditions;
+}
+
+void UKeyedArrayComponent::SetKeyCondition(const FName Key, EKeyedArrayKeyCondition Condition)
+{
+	if (KeyConditions.Get(Key) == Condition)
+		return;
+
+	KeyConditions.PerKey.Add(Key, Condition);
+	MarkKeyedArrayDirty();
+}
+
+void UKeyedArrayComponent::SetDefaultKeyCondition(EKeyedArrayKeyCondition Condition)
+{
+	if (KeyConditions.Default == Condition)
+		return;
+
+	KeyConditions.Default = Condition;
+	MarkKeyedArrayDirty();
+}
+
+void UKeyedArrayComponent::RefreshKeyConditions()
+{
+	if (!KeyConditions.IsUnconditional())
+		MarkKeyedArrayDirty();
+}
+
+bool UKeyedArrayComponent::ShouldReplicateKey(const FName Key, const UNetConnection* Connection, bool bIsOwner) const
+{
+	return true;
+}
+
+int64 UKeyedArrayComponent::GetAllocatedSize() const
+{
+	return GetKeyedArrayAllocatedSize();
+}
+
+int64 UKeyedArrayComponent::GetSlackSize() const
+{
+	return GetKeyedArraySlackSize();
+}
+
+void UKeyedArrayComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
+{
+	Super::GetResourceSizeEx(CumulativeResourceSize);
+
+	// So the Keyed Arrays show up in memreport and obj list.
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(GetKeyedArrayAllocatedSize());
+}
+
+void UKeyedArrayComponent::OnRegister()
+{
+	Super::OnRegister();
+
+	if (!bUseStoragePool || bStorageAcquired || IsTemplate())
+		return;
+
+	if (UKeyedArrayStoragePool* Pool = UWorld::GetSubsystem<UKeyedArrayStoragePool>(GetWorld()))
+	{
+		AcquireStorage(*Pool);
+		bStorageAcquired = true;
+	}
+}
+
+void UKeyedArrayComponent::OnComponentDestroyed(bool bDestroyingHierarchy)
+{
+	if (bUseStoragePool && !IsTemplate())
+	{
+		if (UKeyedArrayStoragePool* Pool = UWorld::GetSubsystem<UKeyedArrayStoragePool>(GetWorld()))
+			ReleaseStorage(*Pool);
+	}
+
+	Super::OnComponentDestroyed(bDestroyingHierarchy);
+}
+
+void UKeyedArrayComponent::SubmitChanges(const FKeyedArrayChangeSet& ChangeSet)
+{
+	if (ChangeSet.IsEmpty())
+		return;
+	
+	if (BatchDepth > 0)
+		BatchedChanges.Append(ChangeSet);
+	else
+		FlushChanges(ChangeSet);
+}
+
+void UKeyedArrayComponent::NotifyKeysChanged(const FKeyedArrayChangeSet& ChangeSet)
+{
+	if (ChangeSet.IsEmpty())
+		return;
+	
+	OnKeyedArrayKeysChanged.Broadcast(ChangeSet);
+
+	// Only the listeners of the keys in the change set get woken up.
+	if (KeyBindings.Num() == 0)
+		return;
+	
+	for (const FName& Key : ChangeSet.Added)
+		NotifyKey(Key, EKeyedArrayChangeType::Added);
+
+	for (const FName& Key : ChangeSet.Removed)
+		NotifyKey(Key, EKeyedArrayChangeType::Removed);
+
+	for (const FName& Key : ChangeSet.Changed)
+		NotifyKey(Key, EKeyedArrayChangeType::Changed);
+}
+
+void UKeyedArrayComponent::NotifyIfFullySynced()
+{
+	if (bFullySynced || NumPairsToCome > 0)
+		return;
+
+	bFullySynced = true;
+	OnKeyedArrayFullySynced.Broadcast();
+}
+
+void UKeyedArrayComponent::ScheduleNextChunk()
+{
+	UWorld* World = GetWorld();
+	if (bNextChunkScheduled || !World)
+		return;
+
+	// Push model clears dirty properties once they have been replicated this frame, so mark it on the next one.
+	bNextChunkScheduled = true;
+	World->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateWeakLambda(this, [this]()
+	{
+		bNextChunkScheduled = false;
+		MarkKeyedArrayPropertyDirty();
+		if (AActor* Owner = GetOwner())
+			Owner->ForceNetUpdate();
+	}));
+}
+
+void UKeyedArrayComponent::ReceivePairsToCome(int32 NumPairs)
+{
+	NumPairsToCome = NumPairs;
+	if (NumPairsToCome > 0)
+		bFullySynced = false;
+}
+
+void UKeyedArrayComponent::NotifyKey(const FName Key, EKeyedArrayChangeType ChangeType)
+{
+	const TArray<FKeyedArrayKeyChangedSignature>* Bindings = KeyBindings.Find(Key);
+	if (!Bindings)
+		return;
+
+	// Copied since a listener may unbind itself while being notified.
+	const TArray<FKeyedArrayKeyChangedSignature> BindingsCopy = *Bindings;
+	for (const FKeyedArrayKeyChangedSignature& Binding : BindingsCopy)
+		Binding.ExecuteIfBound(Key, ChangeType);
+}
+
+namespace
+{
+	struct FKeyedArrayMemoryStats
+	{
+		int32 NumComponents = 0;
+		int64 AllocatedSize = 0;
+		int64 SlackSize = 0;
+
+		void Add(const UKeyedArrayComponent& Component)
+		{
+			NumComponents++;
+			AllocatedSize += Component.GetAllocatedSize();
+			SlackSize += Component.GetSlackSize();
+		}
+	};
+
+	void ReportKeyedArrayMemory(FOutputDevice& Ar)
+	{
+		TMap<const UClass*, FKeyedArrayMemoryStats> StatsPerOwnerClass;
+		FKeyedArrayMemoryStats Total;
+		for (TObjectIterator<UKeyedArrayComponent> It; It; ++It)
+		{
+			const UKeyedArrayComponent* Component = *It;
+			if (Component->IsTemplate())
+				continue;
+
+			const AActor* Owner = Component->GetOwner();
+			StatsPerOwnerClass.FindOrAdd(Owner ? Owner->GetClass() : nullptr).Add(*Component);
+			Total.Add(*Component);
+		}
+
+		StatsPerOwnerClass.ValueSort([](const FKeyedArrayMemoryStats& A, const FKeyedArrayMemoryStats& B)
+		{
+			return A.AllocatedSize > B.AllocatedSize;
+		});
+
+		Ar.Logf(TEXT("%-48s %10s %14s %14s"), TEXT("Owner class"), TEXT("Components"), TEXT("Allocated"), TEXT("Slack"));
+		for (const TPair<const UClass*, FKeyedArrayMemoryStats>& Entry : StatsPerOwnerClass)
+		{
+			Ar.Logf(TEXT("%-48s %10d %14lld %14lld"), Entry.Key ? *Entry.Key->GetName() : TEXT("(No owner)"),
+				Entry.Value.NumComponents, Entry.Value.AllocatedSize, Entry.Value.SlackSize);
+		}
+
+		Ar.Logf(TEXT("%-48s %10d %14lld %14lld"), TEXT("Total"), Total.NumComponents, Total.AllocatedSize, Total.SlackSize);
+
+		for (TObjectIterator<UKeyedArrayStoragePool> It; It; ++It)
+		{
+			if (It->IsTemplate())
+				continue;
+
+			const FKeyedArrayStoragePoolStats Stats = It->GetStats();
+			Ar.Logf(TEXT("Storage pool of %s: %d hits, %d misses, %d returns, %d discards, %d pooled (%lld bytes)"),
+				*GetNameSafe(It->GetWorld()), Stats.Hits, Stats.Misses, Stats.Returns, Stats.Discards, Stats.NumPooled,
+				Stats.PooledBytes);
+		}
+	}
+}
+
+static FAutoConsoleCommandWithOutputDevice KeyedArrayMemReportCommand(
+	TEXT("KeyedArray.MemReport"),
+	TEXT("Lists the memory allocated by every live Keyed Array component, and how much of it is slack, per owner class. Also lists the stats of every world's storage pool."),
+	FConsoleCommandWithOutputDeviceDelegate::CreateStatic(&ReportKeyedArrayMemory));
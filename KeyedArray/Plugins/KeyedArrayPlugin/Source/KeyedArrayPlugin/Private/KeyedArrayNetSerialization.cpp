@@ -0,0 +1,172 @@
+﻿#include "KeyedArrayNetSerialization.h"
+
+#include "Math/Float16.h"
+#include "Misc/Crc.h"
+
+void UKeyedArrayKeyDictionary::PostInitProperties()
+{
+	Super::PostInitProperties();
+	RebuildKeyIndices();
+}
+
+void UKeyedArrayKeyDictionary::PostReloadConfig(FProperty* PropertyThatWasLoaded)
+{
+	Super::PostReloadConfig(PropertyThatWasLoaded);
+	RebuildKeyIndices();
+}
+
+bool UKeyedArrayKeyDictionary::NetSerializeKey(FArchive& Ar, FName& Key)
+{
+	return GetDefault<UKeyedArrayKeyDictionary>()->SerializeKey(Ar, Key);
+}
+
+bool UKeyedArrayKeyDictionary::SerializeKey(FArchive& Ar, FName& Key) const
+{
+	uint8 bInDictionary = 0;
+	uint32 KeyIndex = 0;
+	if (Ar.IsSaving())
+	{
+		if (const int32* FoundIndex = KeyIndices.Find(Key))
+		{
+			bInDictionary = 1;
+			KeyIndex = *FoundIndex;
+		}
+	}
+
+	Ar.SerializeBits(&bInDictionary, 1);
+	if (!bInDictionary)
+		return UPackageMap::StaticSerializeName(Ar, Key);
+
+	Ar.SerializeIntPacked(KeyIndex);
+	if (Ar.IsLoading())
+	{
+		if (!Keys.IsValidIndex(KeyIndex))
+		{
+			// The dictionary doesn't match the sender's.
+			Key = NAME_None;
+			Ar.SetError();
+			return false;
+		}
+
+		Key = Keys[KeyIndex];
+	}
+
+	return true;
+}
+
+void UKeyedArrayKeyDictionary::SetKeys(const TArray<FName>& InKeys)
+{
+	Keys = InKeys;
+	RebuildKeyIndices();
+}
+
+bool UKeyedArrayKeyDictionary::NetSerializeChecksum(FNetDeltaSerializeInfo& DeltaParms)
+{
+	const UKeyedArrayKeyDictionary* Dictionary = GetDefault<UKeyedArrayKeyDictionary>();
+	if (DeltaParms.Writer)
+		return Dictionary->SerializeChecksum(*DeltaParms.Writer, !DeltaParms.OldState && Dictionary->Keys.Num() > 0);
+
+	if (DeltaParms.Reader)
+		return Dictionary->SerializeChecksum(*DeltaParms.Reader, false);
+
+	return true;
+}
+
+bool UKeyedArrayKeyDictionary::SerializeChecksum(FArchive& Ar, bool bSend) const
+{
+	uint8 bHasChecksum = bSend ? 1 : 0;
+	Ar.SerializeBits(&bHasChecksum, 1);
+	if (!bHasChecksum)
+		return true;
+
+	uint32 SentChecksum = Checksum;
+	Ar << SentChecksum;
+	if (Ar.IsLoading() && SentChecksum != Checksum)
+	{
+		// The dictionary doesn't match the sender's.
+		Ar.SetError();
+		return false;
+	}
+
+	return !Ar.IsError();
+}
+
+void UKeyedArrayKeyDictionary::RebuildKeyIndices()
+{
+	KeyIndices.Reset();
+	for (int32 i = 0; i < Keys.Num(); i++)
+		KeyIndices.Add(Keys[i], i);
+
+	// Lowercase since FNames, and so the dictionary lookups, ignore the case.
+	Checksum = 0;
+	if (Keys.Num() > 0)
+	{
+		Checksum = Keys.Num();
+		for (const FName& Key : Keys)
+			Checksum = FCrc::StrCrc32(*Key.ToString().ToLower(), Checksum);
+	}
+}
+
+bool FKeyedArrayValueQuantization::SerializeValue(FArchive& Ar, float& Value) const
+{
+	switch (Mode)
+	{
+	case EKeyedArrayQuantization::Half:
+	{
+		FFloat16 HalfValue(Value);
+		Ar << HalfValue;
+		Value = HalfValue;
+		return true;
+	}
+	case EKeyedArrayQuantization::Fixed:
+	{
+		const int32 Bits = GetNumBits();
+		const uint32 MaxQuantized = (1u << Bits) - 1;
+		const float Range = Max - Min;
+
+		uint32 Quantized = 0;
+		if (Ar.IsSaving() && Range > 0.f)
+			Quantized = FMath::RoundToInt((FMath::Clamp(Value, Min, Max) - Min) / Range * MaxQuantized);
+
+		Ar.SerializeBits(&Quantized, Bits);
+		if (Ar.IsLoading())
+			Value = Min + Range * Quantized / MaxQuantized;
+
+		return true;
+	}
+	default:
+		Ar << Value;
+		return true;
+	}
+}
+
+int32 FKeyedArrayValueQuantization::GetNumBits() const
+{
+	switch (Mode)
+	{
+	case EKeyedArrayQuantization::Half:
+		return 16;
+	case EKeyedArrayQuantization::Fixed:
+		return FMath::Clamp(NumBits, 1, 24);
+	default:
+		return 32;
+	}
+}
+
+static thread_local const FKeyedArrayNetQuantization* CurrentNetQuantization = nullptr;
+
+const FKeyedArrayNetQuantization* FKeyedArrayNetQuantization::GetCurrent()
+{
+	return CurrentNetQuantization;
+}
+
+FKeyedArrayNetQuantization::FScope::FScope(const FKeyedArrayNetQuantization* Quantization)
+{
+	Previous = CurrentNetQuantization;
+	CurrentNetQuantization = Quantization;
+}
+
+FKeyedArrayNetQuantization::FScope::~FScope()
+{
+	CurrentNetQuantization = Previous;
+}
@@ -0,0 +1,143 @@
+﻿#include "KeyedArrayReplicationChunks.h"
+
+#include "Engine/NetSerialization.h"
+#include "KeyedArrayComponent.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+
+/** Assumed size of a pair until the component has written some and knows better. */
+static constexpr float InitialBytesPerPair = 32.f;
+
+/** The Fast Array writes the ReplicationID of every pair ahead of it, byte aligned rather than packed. */
+static constexpr float BytesPerReplicationID = 4.f;
+
+static thread_local FKeyedArrayChunkScope* CurrentChunkScope = nullptr;
+
+FKeyedArrayChunkScope::FKeyedArrayChunkScope(FNetDeltaSerializeInfo& InDeltaParms)
+	: DeltaParms(InDeltaParms)
+{
+	Previous = CurrentChunkScope;
+	CurrentChunkScope = nullptr;
+
+	// Clients receive the count of pairs to come whatever their own MaxBytesPerUpdate is.
+	Component = Cast<UKeyedArrayComponent>(DeltaParms.Object);
+	if (!Component || Component->MaxBytesPerUpdate <= 0 || !DeltaParms.Writer)
+		return;
+
+	// Clients writing replays send everything they have.
+	bLimiting = !DeltaParms.bIsWritingOnClient;
+	StartBits = DeltaParms.Writer->GetNumBits();
+}
+
+FKeyedArrayChunkScope::~FKeyedArrayChunkScope()
+{
+	CurrentChunkScope = Previous;
+}
+
+FKeyedArrayChunkScope* FKeyedArrayChunkScope::GetCurrent()
+{
+	return CurrentChunkScope;
+}
+
+void FKeyedArrayChunkScope::SelectPendingPairs(const void* Pairs, int32 NumPairs, TArray<int32>& PendingPairs, TFunctionRef<FName(int32)> GetKeyName)
+{
+	if (!bLimiting)
+		return;
+
+	const float BytesPerPair = Component->BytesPerPairEstimate > 0.f ? Component->BytesPerPairEstimate : InitialBytesPerPair;
+	const int32 Budget = FMath::Max(1, FMath::FloorToInt(Component->MaxBytesPerUpdate / BytesPerPair));
+
+	NumSelected = FMath::Min(Budget, PendingPairs.Num());
+	NumPairsToCome = PendingPairs.Num() - NumSelected;
+
+	// Priorities only matter when some pairs have to wait, and are looked up once per pending pair.
+	if (NumPairsToCome > 0 && Component->KeyPriorities.Num() > 0)
+	{
+		TArray<TPair<int32, int32>> Prioritized;
+		Prioritized.Reserve(PendingPairs.Num());
+		for (const int32 Index : PendingPairs)
+			Prioritized.Emplace(Index, Component->KeyPriorities.FindRef(GetKeyName(Index)));
+
+		Prioritized.StableSort([](const TPair<int32, int32>& A, const TPair<int32, int32>& B)
+		{
+			return A.Value > B.Value;
+		});
+
+		for (int32 i = 0; i < Prioritized.Num(); i++)
+			PendingPairs[i] = Prioritized[i].Key;
+	}
+
+	SelectedPairs.Init(true, NumPairs);
+	for (int32 i = NumSelected; i < PendingPairs.Num(); i++)
+		SelectedPairs[PendingPairs[i]] = false;
+
+	NewPairs.Init(false, NumPairs);
+	for (int32 i = 0; i < NumSelected; i++)
+		NewPairs[PendingPairs[i]] = true;
+
+	FirstPair = Pairs;
+	CurrentChunkScope = this;
+}
+
+bool FKeyedArrayChunkScope::Finish(bool bSerialized)
+{
+	if (DeltaParms.Writer)
+	{
+		// Nothing gets sent when nothing changed, so neither does the count.
+		if (!bSerialized)
+			return false;
+
+		uint8 bHasPairsToCome = NumPairsToCome > 0 ? 1 : 0;
+		DeltaParms.Writer->SerializeBits(&bHasPairsToCome, 1);
+		if (bHasPairsToCome)
+		{
+			uint32 PairsToCome = NumPairsToCome;
+			DeltaParms.Writer->SerializeIntPacked(PairsToCome);
+		}
+
+		if (!bLimiting)
+			return true;
+
+		// Pairs without a NetSerialize (see KEYED_ARRAY_PAIR_TYPE_TRAITS) can't be measured one by one, so fall back
+		// to the whole update, which overestimates them when pairs the connection already has changed as well.
+		float BytesPerPair = 0.f;
+		if (NumNewPairsMeasured > 0)
+			BytesPerPair = NewPairBits / 8.f / NumNewPairsMeasured + BytesPerReplicationID;
+		else if (NumSelected > 0)
+			BytesPerPair = (DeltaParms.Writer->GetNumBits() - StartBits) / 8.f / NumSelected;
+
+		if (BytesPerPair > 0.f)
+		{
+			Component->BytesPerPairEstimate = Component->BytesPerPairEstimate > 0.f
+				? FMath::Lerp(Component->BytesPerPairEstimate, BytesPerPair, 0.25f)
+				: BytesPerPair;
+		}
+
+		if (NumPairsToCome > 0)
+		{
+			// Otherwise the Fast Array would see the same replication key next time and skip the pairs still to come.
+			if (DeltaParms.NewState && DeltaParms.NewState->IsValid())
+				static_cast<FNetFastTArrayBaseState*>(DeltaParms.NewState->Get())->ArrayReplicationKey = INDEX_NONE;
+
+			Component->ScheduleNextChunk();
+		}
+	}
+	else if (DeltaParms.Reader && bSerialized)
+	{
+		uint8 bHasPairsToCome = 0;
+		DeltaParms.Reader->SerializeBits(&bHasPairsToCome, 1);
+
+		uint32 PairsToCome = 0;
+		if (bHasPairsToCome)
+			DeltaParms.Reader->SerializeIntPacked(PairsToCome);
+
+		if (DeltaParms.Reader->IsError())
+			return false;
+
+		NumPairsToCome = PairsToCome;
+		if (Component)
+			Component->ReceivePairsToCome(NumPairsToCome);
+	}
+
+	return bSerialized;
+}
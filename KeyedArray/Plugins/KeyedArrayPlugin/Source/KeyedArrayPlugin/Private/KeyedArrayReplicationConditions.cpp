@@ -0,0 +1,117 @@
+﻿#include "KeyedArrayReplicationConditions.h"
+
+#include "Engine/ChildConnection.h"
+#include "Engine/NetConnection.h"
+#include "Engine/NetSerialization.h"
+#include "Engine/PackageMapClient.h"
+#include "GameFramework/Actor.h"
+#include "KeyedArrayComponent.h"
+
+bool FKeyedArrayReplicationConditions::IsUnconditional() const
+{
+	if (Default != EKeyedArrayKeyCondition::None)
+		return false;
+
+	for (const TPair<FName, EKeyedArrayKeyCondition>& Pair : PerKey)
+	{
+		if (Pair.Value != EKeyedArrayKeyCondition::None)
+			return false;
+	}
+
+	return true;
+}
+
+bool FKeyedArrayReplicationConditions::DependsOnKey() const
+{
+	if (Default == EKeyedArrayKeyCondition::Custom)
+		return true;
+
+	for (const TPair<FName, EKeyedArrayKeyCondition>& Pair : PerKey)
+	{
+		if (Pair.Value != Default)
+			return true;
+	}
+
+	return false;
+}
+
+static thread_local const FKeyedArrayReplicationConditions::FContext* CurrentConditionContext = nullptr;
+
+const FKeyedArrayReplicationConditions::FContext* FKeyedArrayReplicationConditions::GetCurrent()
+{
+	return CurrentConditionContext;
+}
+
+static bool EvaluateKeyCondition(EKeyedArrayKeyCondition Condition, const FKeyedArrayReplicationConditions::FContext& Context, const FName Key)
+{
+	switch (Condition)
+	{
+	case EKeyedArrayKeyCondition::OwnerOnly:
+		return Context.bIsOwner;
+	case EKeyedArrayKeyCondition::SkipOwner:
+		return !Context.bIsOwner;
+	case EKeyedArrayKeyCondition::Custom:
+		return Context.Component->ShouldReplicateKey(Key, Context.Connection, Context.bIsOwner);
+	default:
+		return true;
+	}
+}
+
+bool FKeyedArrayReplicationConditions::ShouldReplicateName(const FName Key)
+{
+	const FContext& Context = *CurrentConditionContext;
+	return EvaluateKeyCondition(Context.Component->GetKeyConditions().Get(Key), Context, Key);
+}
+
+FKeyedArrayReplicationConditions::FScope::FScope(const FNetDeltaSerializeInfo& DeltaParms)
+{
+	Previous = CurrentConditionContext;
+	CurrentConditionContext = nullptr;
+
+	// Only the server picks what to send. Clients read whatever they are sent.
+	if (!DeltaParms.Writer || DeltaParms.bIsWritingOnClient)
+		return;
+
+	const UKeyedArrayComponent* Component = Cast<UKeyedArrayComponent>(DeltaParms.Object);
+	if (!Component || Component->GetKeyConditions().IsUnconditional())
+		return;
+
+	UPackageMapClient* PackageMap = Cast<UPackageMapClient>(DeltaParms.Map);
+	UNetConnection* Connection = PackageMap ? PackageMap->GetConnection() : nullptr;
+	if (!Connection)
+		return;
+
+	// Split screen players have their own child connection but share the package map of its parent.
+	const AActor* Owner = Component->GetOwner();
+	UNetConnection* OwnerConnection = Owner ? Owner->GetNetConnection() : nullptr;
+	if (OwnerConnection && OwnerConnection->GetUChildConnection())
+		OwnerConnection = OwnerConnection->GetUChildConnection()->Parent;
+
+	Begin(Component, Connection, OwnerConnection == Connection);
+}
+
+FKeyedArrayReplicationConditions::FScope::FScope(const UKeyedArrayComponent* Component, const UNetConnection* Connection, bool bIsOwner)
+{
+	Previous = CurrentConditionContext;
+	CurrentConditionContext = nullptr;
+
+	if (Component && !Component->GetKeyConditions().IsUnconditional())
+		Begin(Component, Connection, bIsOwner);
+}
+
+void FKeyedArrayReplicationConditions::FScope::Begin(const UKeyedArrayComponent* Component, const UNetConnection* Connection, bool bIsOwner)
+{
+	Context.Component = Component;
+	Context.Connection = Connection;
+	Context.bIsOwner = bIsOwner;
+	Context.bDependsOnKey = Component->GetKeyConditions().DependsOnKey();
+	if (!Context.bDependsOnKey)
+		Context.bReplicateEveryKey = EvaluateKeyCondition(Component->GetKeyConditions().Default, Context, NAME_None);
+
+	CurrentConditionContext = &Context;
+}
+
+FKeyedArrayReplicationConditions::FScope::~FScope()
+{
+	CurrentConditionContext = Previous;
+}
@@ -0,0 +1,31 @@
+﻿#include "KeyedArrayStoragePool.h"
+
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarKeyedArrayPoolMaxPerType(
+	TEXT("KeyedArray.Pool.MaxPerType"),
+	256,
+	TEXT("How many storages of each Keyed Array type a world's storage pool keeps for reuse."));
+
+void UKeyedArrayStoragePool::Deinitialize()
+{
+	Trim();
+	Super::Deinitialize();
+}
+
+FKeyedArrayStoragePoolStats UKeyedArrayStoragePool::GetStats() const
+{
+	return Stats;
+}
+
+void UKeyedArrayStoragePool::Trim()
+{
+	Buckets.Empty();
+	Stats.NumPooled = 0;
+	Stats.PooledBytes = 0;
+}
+
+int32 UKeyedArrayStoragePool::GetMaxPooledPerType()
+{
+	return CVarKeyedArrayPoolMaxPerType.GetValueOnGameThread();
+}
@@ -1,10 +1,12 @@
 ﻿#include "NameFloatKeyedArray.h"
 
+#include "KeyedArrayStoragePool.h"
 #include "Net/Core/PushModel/PushModel.h"
 
 UNameFloatKAComponent::UNameFloatKAComponent()
 {
 	SetIsReplicatedByDefault(true);
+	CachedMapKeyGeneration = KeyedArray.GetKeyGeneration() - 1;
 }
 
 void UNameFloatKAComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -19,8 +21,48 @@ void UNameFloatKAComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>
 
 void UNameFloatKAComponent::OnRep_KeyedArray()
 {
-	if (KeyedArray.Clean())
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+	// The Fast Array callbacks have already patched the map and collected which keys changed.
+	OnKeyedArrayChanged.Broadcast(KeyedArray);
+	NotifyKeysChanged(KeyedArray.ConsumeReplicatedChanges());
+	NotifyIfFullySynced();
+}
+
+void UNameFloatKAComponent::FlushChanges(const FKeyedArrayChangeSet& ChangeSet)
+{
+	MARK_PROPERTY_DIRTY_FROM_NAME( UNameFloatKAComponent, KeyedArray, this );
+	OnKeyedArrayChanged.Broadcast(KeyedArray);
+	NotifyKeysChanged(ChangeSet);
+}
+
+void UNameFloatKAComponent::MarkKeyedArrayDirty()
+{
+	KeyedArray.MarkArrayDirty();
+	MarkKeyedArrayPropertyDirty();
+}
+
+void UNameFloatKAComponent::MarkKeyedArrayPropertyDirty()
+{
+	MARK_PROPERTY_DIRTY_FROM_NAME( UNameFloatKAComponent, KeyedArray, this );
+}
+
+SIZE_T UNameFloatKAComponent::GetKeyedArrayAllocatedSize() const
+{
+	return KeyedArray.GetAllocatedSize();
+}
+
+SIZE_T UNameFloatKAComponent::GetKeyedArraySlackSize() const
+{
+	return KeyedArray.GetSlackSize();
+}
+
+void UNameFloatKAComponent::AcquireStorage(UKeyedArrayStoragePool& Pool)
+{
+	Pool.Acquire(KeyedArray);
+}
+
+void UNameFloatKAComponent::ReleaseStorage(UKeyedArrayStoragePool& Pool)
+{
+	Pool.Release(KeyedArray);
 }
 
 float UNameFloatKAComponent::Get(const FName Key)
@@ -45,7 +87,13 @@ const TArray<FNameFloatPair>& UNameFloatKAComponent::GetData()
 
 const TMap<FName, int>& UNameFloatKAComponent::GetMap()
 {
-	return KeyedArray.GetTranslator();
+	if (CachedMapKeyGeneration != KeyedArray.GetKeyGeneration() || CachedMap.Num() != KeyedArray.Num())
+	{
+		CachedMap = KeyedArray.GetTranslatorAsMap();
+		CachedMapKeyGeneration = KeyedArray.GetKeyGeneration();
+	}
+
+	return CachedMap;
 }
 
 int32 UNameFloatKAComponent::Add(const FName Key, float Item)
@@ -53,11 +101,17 @@ int32 UNameFloatKAComponent::Add(const FName Key, float Item)
 	if (!GetOwner()->HasAuthority())
 		return -1;
 
+	const int32 NumBefore = KeyedArray.Num();
 	const int32 Index = KeyedArray.Add(Key, Item);
 	if (Index >= 0)
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameFloatKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		FKeyedArrayChangeSet ChangeSet;
+		if (KeyedArray.Num() != NumBefore)
+			ChangeSet.MarkAdded(Key);
+		else
+			ChangeSet.MarkChanged(Key);
+		
+		SubmitChanges(ChangeSet);
 	}
 
 	return Index;
@@ -68,11 +122,17 @@ int32 UNameFloatKAComponent::Emplace(const FName Key, float Item)
 	if (!GetOwner()->HasAuthority())
 		return -1;
 
+	const int32 NumBefore = KeyedArray.Num();
 	const int32 Index = KeyedArray.Emplace(Key, Item);
 	if (Index >= 0)
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameFloatKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		FKeyedArrayChangeSet ChangeSet;
+		if (KeyedArray.Num() != NumBefore)
+			ChangeSet.MarkAdded(Key);
+		else
+			ChangeSet.MarkChanged(Key);
+		
+		SubmitChanges(ChangeSet);
 	}
 
 	return Index;
@@ -86,8 +146,9 @@ bool UNameFloatKAComponent::Remove(const FName Key)
 	const bool bRemoved = KeyedArray.Remove(Key);
 	if (bRemoved)
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameFloatKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		FKeyedArrayChangeSet ChangeSet;
+		ChangeSet.MarkRemoved(Key);
+		SubmitChanges(ChangeSet);
 	}
 
 	return bRemoved;
@@ -98,16 +159,111 @@ bool UNameFloatKAComponent::RemoveAt(int32 Index)
 	if (!GetOwner()->HasAuthority())
 		return false;
 	
+	const FName Key = KeyedArray.GetKey(Index);
 	const bool bRemoved = KeyedArray.RemoveAt(Index);
 	if (bRemoved)
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameFloatKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		FKeyedArrayChangeSet ChangeSet;
+		ChangeSet.MarkRemoved(Key);
+		SubmitChanges(ChangeSet);
+	}
+
+	return bRemoved;
+}
+
+bool UNameFloatKAComponent::RemoveSwap(const FName Key)
+{
+	if (!GetOwner()->HasAuthority())
+		return false;
+
+	const bool bRemoved = KeyedArray.RemoveSwap(Key);
+	if (bRemoved)
+	{
+		FKeyedArrayChangeSet ChangeSet;
+		ChangeSet.MarkRemoved(Key);
+		SubmitChanges(ChangeSet);
+	}
+
+	return bRemoved;
+}
+
+bool UNameFloatKAComponent::RemoveAtSwap(int32 Index)
+{
+	if (!GetOwner()->HasAuthority())
+		return false;
+	
+	const FName Key = KeyedArray.GetKey(Index);
+	const bool bRemoved = KeyedArray.RemoveAtSwap(Index);
+	if (bRemoved)
+	{
+		FKeyedArrayChangeSet ChangeSet;
+		ChangeSet.MarkRemoved(Key);
+		SubmitChanges(ChangeSet);
 	}
 
 	return bRemoved;
 }
 
+int32 UNameFloatKAComponent::RemoveFirst(float Item)
+{
+	if (!GetOwner()->HasAuthority())
+		return -1;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Index = KeyedArray.RemoveFirst(Item, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Index;
+}
+
+int32 UNameFloatKAComponent::RemoveAll(float Item)
+{
+	if (!GetOwner()->HasAuthority())
+		return 0;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Removals = KeyedArray.RemoveAll(Item, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Removals;
+}
+
+int32 UNameFloatKAComponent::Append(const TArray<FNameFloatPair>& Pairs)
+{
+	if (!GetOwner()->HasAuthority())
+		return 0;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Additions = KeyedArray.Append(Pairs, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Additions;
+}
+
+int32 UNameFloatKAComponent::AddMany(const TArray<FName>& Keys, const TArray<float>& Items)
+{
+	if (!GetOwner()->HasAuthority() || Keys.Num() != Items.Num())
+		return 0;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Additions = KeyedArray.AddMany(Keys, Items, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Additions;
+}
+
+int32 UNameFloatKAComponent::RemoveMany(const TArray<FName>& Keys)
+{
+	if (!GetOwner()->HasAuthority())
+		return 0;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Removals = KeyedArray.RemoveMany(Keys, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Removals;
+}
+
 FName UNameFloatKAComponent::GetKey(int32 Index)
 {
 	return KeyedArray.GetKey(Index);
@@ -130,8 +286,36 @@ void UNameFloatKAComponent::Empty(int32 AllocatedElements)
 
 	if (KeyedArray.Num() > 0)
 	{
+		FKeyedArrayChangeSet ChangeSet;
+		for (const FNameFloatPair& Pair : KeyedArray.GetData())
+			ChangeSet.MarkRemoved(Pair.Key);
+		
 		KeyedArray.Empty(AllocatedElements);
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameFloatKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		SubmitChanges(ChangeSet);
 	}
 }
+
+void UNameFloatKAComponent::Reserve(int32 Number)
+{
+	KeyedArray.Reserve(Number);
+}
+
+void UNameFloatKAComponent::Shrink()
+{
+	KeyedArray.Shrink();
+}
+
+void UNameFloatKAComponent::SetValueIndexEnabled(bool bEnabled)
+{
+	KeyedArray.SetValueIndexEnabled(bEnabled);
+}
+
+void UNameFloatKAComponent::ScaleAll(float Scale)
+{
+	if (!GetOwner()->HasAuthority() || KeyedArray.Num() == 0)
+		return;
+
+	FKeyedArrayChangeSet ChangeSet;
+	KeyedArray.ScaleAll(Scale, &ChangeSet);
+	SubmitChanges(ChangeSet);
+}
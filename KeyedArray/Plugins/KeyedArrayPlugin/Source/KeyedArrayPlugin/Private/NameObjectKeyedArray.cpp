@@ -1,10 +1,12 @@
 ﻿#include "NameObjectKeyedArray.h"
 
+#include "KeyedArrayStoragePool.h"
 #include "Net/Core/PushModel/PushModel.h"
 
 UNameObjectKAComponent::UNameObjectKAComponent()
 {
 	SetIsReplicatedByDefault(true);
+	CachedMapKeyGeneration = KeyedArray.GetKeyGeneration() - 1;
 }
 
 void UNameObjectKAComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
@@ -19,8 +21,48 @@ void UNameObjectKAComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty
 
 void UNameObjectKAComponent::OnRep_KeyedArray()
 {
-	if (KeyedArray.Clean())
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+	// The Fast Array callbacks have already patched the map and collected which keys changed.
+	OnKeyedArrayChanged.Broadcast(KeyedArray);
+	NotifyKeysChanged(KeyedArray.ConsumeReplicatedChanges());
+	NotifyIfFullySynced();
+}
+
+void UNameObjectKAComponent::FlushChanges(const FKeyedArrayChangeSet& ChangeSet)
+{
+	MARK_PROPERTY_DIRTY_FROM_NAME( UNameObjectKAComponent, KeyedArray, this );
+	OnKeyedArrayChanged.Broadcast(KeyedArray);
+	NotifyKeysChanged(ChangeSet);
+}
+
+void UNameObjectKAComponent::MarkKeyedArrayDirty()
+{
+	KeyedArray.MarkArrayDirty();
+	MarkKeyedArrayPropertyDirty();
+}
+
+void UNameObjectKAComponent::MarkKeyedArrayPropertyDirty()
+{
+	MARK_PROPERTY_DIRTY_FROM_NAME( UNameObjectKAComponent, KeyedArray, this );
+}
+
+SIZE_T UNameObjectKAComponent::GetKeyedArrayAllocatedSize() const
+{
+	return KeyedArray.GetAllocatedSize();
+}
+
+SIZE_T UNameObjectKAComponent::GetKeyedArraySlackSize() const
+{
+	return KeyedArray.GetSlackSize();
+}
+
+void UNameObjectKAComponent::AcquireStorage(UKeyedArrayStoragePool& Pool)
+{
+	Pool.Acquire(KeyedArray);
+}
+
+void UNameObjectKAComponent::ReleaseStorage(UKeyedArrayStoragePool& Pool)
+{
+	Pool.Release(KeyedArray);
 }
 
 UObject* UNameObjectKAComponent::Get(const FName Key)
@@ -45,7 +87,13 @@ const TArray<FNameObjectPair>& UNameObjectKAComponent::GetData()
 
 const TMap<FName, int>& UNameObjectKAComponent::GetMap()
 {
-	return KeyedArray.GetTranslator();
+	if (CachedMapKeyGeneration != KeyedArray.GetKeyGeneration() || CachedMap.Num() != KeyedArray.Num())
+	{
+		CachedMap = KeyedArray.GetTranslatorAsMap();
+		CachedMapKeyGeneration = KeyedArray.GetKeyGeneration();
+	}
+
+	return CachedMap;
 }
 
 int32 UNameObjectKAComponent::Add(const FName Key, UObject* Item)
@@ -53,11 +101,17 @@ int32 UNameObjectKAComponent::Add(const FName Key, UObject* Item)
 	if (!GetOwner()->HasAuthority())
 		return -1;
 
+	const int32 NumBefore = KeyedArray.Num();
 	const int32 Index = KeyedArray.Add(Key, Item);
 	if (Index >= 0)
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameObjectKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		FKeyedArrayChangeSet ChangeSet;
+		if (KeyedArray.Num() != NumBefore)
+			ChangeSet.MarkAdded(Key);
+		else
+			ChangeSet.MarkChanged(Key);
+		
+		SubmitChanges(ChangeSet);
 	}
 
 	return Index;
@@ -68,11 +122,17 @@ int32 UNameObjectKAComponent::Emplace(const FName Key, UObject* Item)
 	if (!GetOwner()->HasAuthority())
 		return -1;
 
+	const int32 NumBefore = KeyedArray.Num();
 	const int32 Index = KeyedArray.Emplace(Key, Item);
 	if (Index >= 0)
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameObjectKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		FKeyedArrayChangeSet ChangeSet;
+		if (KeyedArray.Num() != NumBefore)
+			ChangeSet.MarkAdded(Key);
+		else
+			ChangeSet.MarkChanged(Key);
+		
+		SubmitChanges(ChangeSet);
 	}
 
 	return Index;
@@ -86,8 +146,9 @@ bool UNameObjectKAComponent::Remove(const FName Key)
 	const bool bRemoved = KeyedArray.Remove(Key);
 	if (bRemoved)
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameObjectKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		FKeyedArrayChangeSet ChangeSet;
+		ChangeSet.MarkRemoved(Key);
+		SubmitChanges(ChangeSet);
 	}
 
 	return bRemoved;
@@ -98,16 +159,123 @@ bool UNameObjectKAComponent::RemoveAt(int32 Index)
 	if (!GetOwner()->HasAuthority())
 		return false;
 	
+	const FName Key = KeyedArray.GetKey(Index);
 	const bool bRemoved = KeyedArray.RemoveAt(Index);
 	if (bRemoved)
 	{
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameObjectKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		FKeyedArrayChangeSet ChangeSet;
+		ChangeSet.MarkRemoved(Key);
+		SubmitChanges(ChangeSet);
+	}
+
+	return bRemoved;
+}
+
+bool UNameObjectKAComponent::RemoveSwap(const FName Key)
+{
+	if (!GetOwner()->HasAuthority())
+		return false;
+
+	const bool bRemoved = KeyedArray.RemoveSwap(Key);
+	if (bRemoved)
+	{
+		FKeyedArrayChangeSet ChangeSet;
+		ChangeSet.MarkRemoved(Key);
+		SubmitChanges(ChangeSet);
+	}
+
+	return bRemoved;
+}
+
+bool UNameObjectKAComponent::RemoveAtSwap(int32 Index)
+{
+	if (!GetOwner()->HasAuthority())
+		return false;
+	
+	const FName Key = KeyedArray.GetKey(Index);
+	const bool bRemoved = KeyedArray.RemoveAtSwap(Index);
+	if (bRemoved)
+	{
+		FKeyedArrayChangeSet ChangeSet;
+		ChangeSet.MarkRemoved(Key);
+		SubmitChanges(ChangeSet);
 	}
 
 	return bRemoved;
 }
 
+int32 UNameObjectKAComponent::RemoveFirst(UObject* Item)
+{
+	if (!GetOwner()->HasAuthority())
+		return -1;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Index = KeyedArray.RemoveFirst(Item, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Index;
+}
+
+int32 UNameObjectKAComponent::RemoveAll(UObject* Item)
+{
+	if (!GetOwner()->HasAuthority())
+		return 0;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Removals = KeyedArray.RemoveAll(Item, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Removals;
+}
+
+int32 UNameObjectKAComponent::RemoveInvalid()
+{
+	if (!GetOwner()->HasAuthority())
+		return 0;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Removals = KeyedArray.RemoveInvalid(&ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Removals;
+}
+
+int32 UNameObjectKAComponent::Append(const TArray<FNameObjectPair>& Pairs)
+{
+	if (!GetOwner()->HasAuthority())
+		return 0;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Additions = KeyedArray.Append(Pairs, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Additions;
+}
+
+int32 UNameObjectKAComponent::AddMany(const TArray<FName>& Keys, const TArray<UObject*>& Items)
+{
+	if (!GetOwner()->HasAuthority() || Keys.Num() != Items.Num())
+		return 0;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Additions = KeyedArray.AddMany(Keys, Items, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Additions;
+}
+
+int32 UNameObjectKAComponent::RemoveMany(const TArray<FName>& Keys)
+{
+	if (!GetOwner()->HasAuthority())
+		return 0;
+
+	FKeyedArrayChangeSet ChangeSet;
+	const int32 Removals = KeyedArray.RemoveMany(Keys, &ChangeSet);
+	SubmitChanges(ChangeSet);
+
+	return Removals;
+}
+
 FName UNameObjectKAComponent::GetKey(int32 Index)
 {
 	return KeyedArray.GetKey(Index);
@@ -130,8 +298,26 @@ void UNameObjectKAComponent::Empty(int32 AllocatedElements)
 
 	if (KeyedArray.Num() > 0)
 	{
+		FKeyedArrayChangeSet ChangeSet;
+		for (const FNameObjectPair& Pair : KeyedArray.GetData())
+			ChangeSet.MarkRemoved(Pair.Key);
+		
 		KeyedArray.Empty(AllocatedElements);
-		MARK_PROPERTY_DIRTY_FROM_NAME( UNameObjectKAComponent, KeyedArray, this );
-		OnKeyedArrayChanged.Broadcast(KeyedArray);
+		SubmitChanges(ChangeSet);
 	}
 }
+
+void UNameObjectKAComponent::Reserve(int32 Number)
+{
+	KeyedArray.Reserve(Number);
+}
+
+void UNameObjectKAComponent::Shrink()
+{
+	KeyedArray.Shrink();
+}
+
+void UNameObjectKAComponent::SetValueIndexEnabled(bool bEnabled)
+{
+	KeyedArray.SetValueIndexEnabled(bEnabled);
+}
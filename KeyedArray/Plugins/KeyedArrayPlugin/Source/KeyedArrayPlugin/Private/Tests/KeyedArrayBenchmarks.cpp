@@ -0,0 +1,440 @@
+﻿#include "CoreMinimal.h"
+#include "InternalKeyedArray.h"
+#include "KeyedArrayDirectMap.h"
+#include "KeyedArrayFlatMap.h"
+#include "KeyedArrayMath.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Microbenchmarks of the Keyed Array internals, run from the Session Frontend under KeyedArray.Benchmarks.
+ * Timings are reported as info, and only differences large enough to never depend on the machine are checked.
+ */
+namespace KeyedArrayBenchmarks
+{
+	template<typename KeyType, typename ValueType>
+	struct TTestPair
+	{
+		KeyType Key;
+		ValueType Value;
+
+		TTestPair()
+		{
+		}
+
+		TTestPair(KeyType NewKey, ValueType NewValue)
+		{
+			Key = NewKey;
+			Value = NewValue;
+		}
+	};
+
+	typedef TTestPair<FName, float> FNameFloatTestPair;
+
+	/** A Keyed Array owning its storage, like the USTRUCTs do. */
+	template<typename KeyType, typename ValueType, typename MapType = TKeyedArrayMap<KeyType>>
+	struct TTestKeyedArray
+	{
+		typedef TTestPair<KeyType, ValueType> PairType;
+
+		TArray<PairType> Pairs;
+		MapType Map;
+		uint32 KeyGeneration = 0;
+		TInternalKeyedArray<KeyType, ValueType, PairType, MapType> Internal;
+
+		TTestKeyedArray()
+			: Internal(&Pairs, &Map, &KeyGeneration)
+		{
+		}
+	};
+
+	/**
+	 * The lookups as they were before every key path got down to a single probe: Contains followed by operator[],
+	 * hashing the key twice on every hit.
+	 */
+	template<typename KeyType, typename ValueType>
+	struct TDoubleProbeBaseline
+	{
+		typedef TTestPair<KeyType, ValueType> PairType;
+
+		TArray<PairType> Pairs;
+		TMap<KeyType, int32> Map;
+
+		PairType* Get(const KeyType Key)
+		{
+			if (Map.Contains(Key))
+				return &Pairs[Map[Key]];
+
+			return nullptr;
+		}
+
+		int32 Add(const KeyType Key, const ValueType& Value)
+		{
+			if (Map.Contains(Key))
+			{
+				const int32 Index = Map[Key];
+				Pairs[Index].Value = Value;
+				return Index;
+			}
+
+			const int32 Index = Pairs.Emplace(Key, Value);
+			Map.Add(Key, Index);
+			return Index;
+		}
+
+		bool RemoveSwap(const KeyType Key)
+		{
+			if (!Map.Contains(Key))
+				return false;
+
+			const int32 Index = Map[Key];
+			Map.Remove(Key);
+			Pairs.RemoveAtSwap(Index);
+			if (Pairs.IsValidIndex(Index))
+				Map[Pairs[Index].Key] = Index;
+
+			return true;
+		}
+	};
+
+	static TArray<FName> MakeNameKeys(int32 Num)
+	{
+		TArray<FName> Keys;
+		Keys.Reserve(Num);
+		for (int32 i = 0; i < Num; i++)
+			Keys.Add(FName(TEXT("BenchmarkKey"), i + 1));
+
+		return Keys;
+	}
+
+	/** Enum keys, as an ability slot or stat ID would be. */
+	enum class EBenchmarkKey : uint16
+	{
+	};
+
+	/**
+	 * Adds a pair for every key and returns the average time of finding the index of one, in nanoseconds.
+	 * OutNumFound counts the keys that were found, so the lookups can't be optimised away.
+	 */
+	template<typename KeyType, typename MapType>
+	static double TimeLookups(const TArray<KeyType>& Keys, int32 NumLookups, int32& OutNumFound)
+	{
+		TTestKeyedArray<KeyType, float, MapType> KeyedArray;
+		for (int32 i = 0; i < Keys.Num(); i++)
+			KeyedArray.Internal.Add(Keys[i], static_cast<float>(i));
+
+		// Walks the keys with a stride so consecutive lookups don't hit neighbouring slots.
+		int32 NumFound = 0;
+		const double Time = TimePerCall(NumLookups, [&](int32 i)
+		{
+			NumFound += KeyedArray.Internal.GetIndex(Keys[(i * 7919) % Keys.Num()]) > -1;
+		});
+
+		OutNumFound = NumFound;
+		return Time;
+	}
+
+	/** Average time of every operation in nanoseconds, from an empty Keyed Array to a full one and back. */
+	struct FMapTimings
+	{
+		double Add = 0;
+		double Get = 0;
+		double Contains = 0;
+		double Rebuild = 0;
+		double Remove = 0;
+	};
+
+	/**
+	 * Times the map policy through a Keyed Array with a pair for every key, repeating it Repeats times so small sizes
+	 * aren't only measuring the timer. Contains looks up the missing keys, so it measures misses.
+	 * Returns false if any lookup gave a wrong result.
+	 */
+	template<typename MapType>
+	static bool TimeMap(const TArray<FName>& Keys, const TArray<FName>& MissingKeys, int32 Repeats, FMapTimings& OutTimings)
+	{
+		const int32 Num = Keys.Num();
+		bool bCorrect = true;
+		for (int32 Repeat = 0; Repeat < Repeats; Repeat++)
+		{
+			TTestKeyedArray<FName, float, MapType> KeyedArray;
+
+			OutTimings.Add += TimePerCall(Num, [&](int32 i)
+			{
+				KeyedArray.Internal.Add(Keys[i], static_cast<float>(i));
+			});
+
+			OutTimings.Get += TimePerCall(Num, [&](int32 i)
+			{
+				const TTestPair<FName, float>* Pair = KeyedArray.Internal.GetPairAsPointer(Keys[i]);
+				bCorrect &= Pair && Pair->Value == static_cast<float>(i);
+			});
+
+			OutTimings.Contains += TimePerCall(Num, [&](int32 i)
+			{
+				bCorrect &= !KeyedArray.Internal.Contains(MissingKeys[i]);
+			});
+
+			OutTimings.Rebuild += TimePerCall(1, [&](int32 i)
+			{
+				KeyedArray.Internal.Rebuild();
+			});
+
+			OutTimings.Remove += TimePerCall(Num, [&](int32 i)
+			{
+				bCorrect &= KeyedArray.Internal.RemoveSwap(Keys[i]);
+			});
+
+			bCorrect &= KeyedArray.Pairs.Num() == 0;
+		}
+
+		OutTimings.Add /= Repeats;
+		OutTimings.Get /= Repeats;
+		OutTimings.Contains /= Repeats;
+		OutTimings.Rebuild /= Repeats;
+		OutTimings.Remove /= Repeats;
+		return bCorrect;
+	}
+
+	/** Calls Body(i) for every i below Num and returns the average time of a call, in nanoseconds. */
+	template<typename BodyType>
+	static double TimePerCall(int32 Num, BodyType&& Body)
+	{
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Num; i++)
+			Body(i);
+
+		return (FPlatformTime::Seconds() - StartTime) * 1e9 / FMath::Max(Num, 1);
+	}
+}
+
+using namespace KeyedArrayBenchmarks;
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKeyedArrayIndexAccessBenchmark, "KeyedArray.Benchmarks.IndexAccess",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKeyedArrayIndexAccessBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 NumPairs = 10000;
+	const int32 NumRemovals = 1000;
+	const TArray<FName> Keys = MakeNameKeys(NumPairs);
+
+	TTestKeyedArray<FName, float> KeyedArray;
+	for (int32 i = 0; i < NumPairs; i++)
+		KeyedArray.Internal.Add(Keys[i], static_cast<float>(i));
+
+	// GetKey reads the key stored in the pair. It used to search the map for the index, which is what this times.
+	int32 NumMatching = 0;
+	const double GetKeyTime = TimePerCall(NumPairs, [&](int32 i)
+	{
+		NumMatching += *KeyedArray.Internal.GetKey(i) == Keys[i];
+	});
+
+	const int32 NumScanned = NumPairs / 10;
+	const double FindKeyTime = TimePerCall(NumScanned, [&](int32 i)
+	{
+		NumMatching += *KeyedArray.Map.FindKey(i * 10) == Keys[i * 10];
+	});
+
+	TestEqual(TEXT("GetKey and FindKey agree"), NumMatching, NumPairs + NumScanned);
+	TestTrue(TEXT("GetKey is faster than searching the map"), GetKeyTime * 10 < FindKeyTime);
+	AddInfo(FString::Printf(TEXT("%d pairs: GetKey %.1f ns, map FindKey %.1f ns"), NumPairs, GetKeyTime, FindKeyTime));
+
+	// RemoveAt should cost the same as removing by key, both shifting the pairs after the removed one.
+	TTestKeyedArray<FName, float> ByKey = KeyedArray;
+	ByKey.Internal.Rebind(&ByKey.Pairs, &ByKey.Map, &ByKey.KeyGeneration);
+
+	const int32 FirstRemoved = NumPairs / 2 - NumRemovals / 2;
+	const double RemoveAtTime = TimePerCall(NumRemovals, [&](int32 i)
+	{
+		KeyedArray.Internal.RemoveAt(FirstRemoved);
+	});
+
+	const double RemoveTime = TimePerCall(NumRemovals, [&](int32 i)
+	{
+		ByKey.Internal.Remove(Keys[FirstRemoved + i]);
+	});
+
+	TestEqual(TEXT("RemoveAt removed every pair"), KeyedArray.Pairs.Num(), NumPairs - NumRemovals);
+	TestEqual(TEXT("Remove removed every pair"), ByKey.Pairs.Num(), NumPairs - NumRemovals);
+	TestFalse(TEXT("RemoveAt leaves the map clean"), KeyedArray.Internal.Clean());
+	AddInfo(FString::Printf(TEXT("%d pairs: RemoveAt %.1f ns, Remove %.1f ns"), NumPairs, RemoveAtTime, RemoveTime));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKeyedArraySingleProbeBenchmark, "KeyedArray.Benchmarks.SingleProbe",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKeyedArraySingleProbeBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 NumPairs = 10000;
+	const TArray<FName> Keys = MakeNameKeys(NumPairs);
+
+	TTestKeyedArray<FName, float> KeyedArray;
+	TDoubleProbeBaseline<FName, float> Baseline;
+	KeyedArray.Pairs.Reserve(NumPairs);
+	Baseline.Pairs.Reserve(NumPairs);
+
+	// Add goes through new keys only, then Get and updates go through existing ones.
+	const double AddTime = TimePerCall(NumPairs, [&](int32 i)
+	{
+		KeyedArray.Internal.Add(Keys[i], static_cast<float>(i));
+	});
+
+	const double BaselineAddTime = TimePerCall(NumPairs, [&](int32 i)
+	{
+		Baseline.Add(Keys[i], static_cast<float>(i));
+	});
+
+	float Sum = 0.f;
+	float BaselineSum = 0.f;
+	const double GetTime = TimePerCall(NumPairs, [&](int32 i)
+	{
+		Sum += KeyedArray.Internal.GetPairAsPointer(Keys[i])->Value;
+	});
+
+	const double BaselineGetTime = TimePerCall(NumPairs, [&](int32 i)
+	{
+		BaselineSum += Baseline.Get(Keys[i])->Value;
+	});
+
+	const double UpdateTime = TimePerCall(NumPairs, [&](int32 i)
+	{
+		KeyedArray.Internal.Add(Keys[i], static_cast<float>(-i));
+	});
+
+	const double BaselineUpdateTime = TimePerCall(NumPairs, [&](int32 i)
+	{
+		Baseline.Add(Keys[i], static_cast<float>(-i));
+	});
+
+	// RemoveSwap keeps the shifting out of the timing, leaving mostly the probes.
+	const double RemoveTime = TimePerCall(NumPairs, [&](int32 i)
+	{
+		KeyedArray.Internal.RemoveSwap(Keys[i]);
+	});
+
+	const double BaselineRemoveTime = TimePerCall(NumPairs, [&](int32 i)
+	{
+		Baseline.RemoveSwap(Keys[i]);
+	});
+
+	TestEqual(TEXT("Get finds the same values"), Sum, BaselineSum);
+	TestEqual(TEXT("Every pair was removed"), KeyedArray.Pairs.Num() + KeyedArray.Map.Num(), 0);
+	TestEqual(TEXT("Every baseline pair was removed"), Baseline.Pairs.Num() + Baseline.Map.Num(), 0);
+
+	AddInfo(FString::Printf(TEXT("%d pairs, single probe vs double probe: Get %.1f / %.1f ns, Add %.1f / %.1f ns, update %.1f / %.1f ns, RemoveSwap %.1f / %.1f ns"),
+		NumPairs, GetTime, BaselineGetTime, AddTime, BaselineAddTime, UpdateTime, BaselineUpdateTime, RemoveTime, BaselineRemoveTime));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKeyedArrayKeyTypeBenchmark, "KeyedArray.Benchmarks.KeyTypes",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKeyedArrayKeyTypeBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 NumKeys = 1024;
+	const int32 NumLookups = 100000;
+
+	const TArray<FName> NameKeys = MakeNameKeys(NumKeys);
+	TArray<uint32> IntegerKeys;
+	TArray<EBenchmarkKey> EnumKeys;
+	TArray<uint16> DenseKeys;
+	for (int32 i = 0; i < NumKeys; i++)
+	{
+		IntegerKeys.Add(static_cast<uint32>(i) * 2654435761u);
+		EnumKeys.Add(static_cast<EBenchmarkKey>(i));
+		DenseKeys.Add(static_cast<uint16>(i));
+	}
+
+	// FName keys hash their comparison index, integers and enums hash as themselves and dense keys skip hashing.
+	int32 NumFound[4];
+	const double NameTime = TimeLookups<FName, TKeyedArrayMap<FName>>(NameKeys, NumLookups, NumFound[0]);
+	const double IntegerTime = TimeLookups<uint32, TKeyedArrayMap<uint32>>(IntegerKeys, NumLookups, NumFound[1]);
+	const double EnumTime = TimeLookups<EBenchmarkKey, TKeyedArrayMap<EBenchmarkKey>>(EnumKeys, NumLookups, NumFound[2]);
+	const double DirectTime = TimeLookups<uint16, TKeyedArrayDirectMap<uint16>>(DenseKeys, NumLookups, NumFound[3]);
+
+	for (int32 i = 0; i < 4; i++)
+		TestEqual(TEXT("Every key is found"), NumFound[i], NumLookups);
+
+	AddInfo(FString::Printf(TEXT("%d keys, GetIndex: FName %.1f ns, uint32 %.1f ns, enum %.1f ns, TKeyedArrayDirectMap %.1f ns"),
+		NumKeys, NameTime, IntegerTime, EnumTime, DirectTime));
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKeyedArrayFlatMapBenchmark, "KeyedArray.Benchmarks.FlatMap",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKeyedArrayFlatMapBenchmark::RunTest(const FString& Parameters)
+{
+	typedef TKeyedArrayFlatMap<FName, TTestPair<FName, float>> FFlatMap;
+
+	const TArray<FName> AllKeys = MakeNameKeys(2 * 65536);
+	for (const int32 Num : { 16, 256, 4096, 65536 })
+	{
+		const TArray<FName> Keys(AllKeys.GetData(), Num);
+		const TArray<FName> MissingKeys(AllKeys.GetData() + Num, Num);
+		const int32 Repeats = FMath::Max(1, 65536 / Num);
+
+		FMapTimings MapTimings;
+		FMapTimings FlatTimings;
+		TestTrue(TEXT("TMap finds every key"), TimeMap<TKeyedArrayMap<FName>>(Keys, MissingKeys, Repeats, MapTimings));
+		TestTrue(TEXT("TKeyedArrayFlatMap finds every key"), TimeMap<FFlatMap>(Keys, MissingKeys, Repeats, FlatTimings));
+
+		AddInfo(FString::Printf(TEXT("%d pairs, TKeyedArrayFlatMap vs TMap: Get %.1f / %.1f ns, Contains (miss) %.1f / %.1f ns, Add %.1f / %.1f ns, RemoveSwap %.1f / %.1f ns, Rebuild %.1f / %.1f us"),
+			Num, FlatTimings.Get, MapTimings.Get, FlatTimings.Contains, MapTimings.Contains, FlatTimings.Add, MapTimings.Add,
+			FlatTimings.Remove, MapTimings.Remove, FlatTimings.Rebuild / 1000, MapTimings.Rebuild / 1000));
+	}
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKeyedArrayFloatAggregatesBenchmark, "KeyedArray.Benchmarks.FloatAggregates",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKeyedArrayFloatAggregatesBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 Repeats = 100;
+	for (const int32 Num : { 16, 256, 4096, 65536 })
+	{
+		TArray<FNameFloatTestPair> Pairs;
+		for (int32 i = 0; i < Num; i++)
+			Pairs.Emplace(FName(), static_cast<float>((i * 7919) % 1000));
+
+		// The scalar passes over the pairs that KEYED_ARRAY_FLOAT_AGGREGATES used to run, against the gathered kernels.
+		int32 ScalarCount = 0;
+		const double ScalarTime = TimePerCall(Repeats, [&](int32 i)
+		{
+			for (const FNameFloatTestPair& Pair : Pairs)
+				ScalarCount += Pair.Value > 500.f;
+		});
+
+		int32 GatheredCount = 0;
+		const double GatheredTime = TimePerCall(Repeats, [&](int32 i)
+		{
+			FKeyedArrayMath::FValueBuffer Values;
+			FKeyedArrayMath::GatherValues(Pairs, Values);
+			GatheredCount += FKeyedArrayMath::CountWhere(Values, EKeyedArrayCompareOp::Greater, 500.f);
+		});
+
+		FKeyedArrayMath::FValueBuffer Values;
+		FKeyedArrayMath::GatherValues(Pairs, Values);
+		int32 ContiguousCount = 0;
+		const double ContiguousTime = TimePerCall(Repeats, [&](int32 i)
+		{
+			ContiguousCount += FKeyedArrayMath::CountWhere(Values, EKeyedArrayCompareOp::Greater, 500.f);
+		});
+
+		TestEqual(TEXT("The gathered count matches"), GatheredCount, ScalarCount);
+		TestEqual(TEXT("The contiguous count matches"), ContiguousCount, ScalarCount);
+		AddInfo(FString::Printf(TEXT("%d pairs, CountWhere: scalar over pairs %.2f us, gathered %.2f us, contiguous (TSoAKeyedArray) %.2f us"),
+			Num, ScalarTime / 1000, GatheredTime / 1000, ContiguousTime / 1000));
+	}
+
+	return true;
+}
+
+#endif
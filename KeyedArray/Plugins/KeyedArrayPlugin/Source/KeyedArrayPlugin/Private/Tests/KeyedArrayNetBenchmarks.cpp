@@ -0,0 +1,402 @@
+﻿#include "CoreMinimal.h"
+#include "KeyedArrayNetSerialization.h"
+#include "KeyedArrayReplicationChunks.h"
+#include "KeyedArrayReplicationConditions.h"
+#include "Misc/AutomationTest.h"
+#include "NameFloatKeyedArray.h"
+#include "Net/Serialization/FastArraySerializer.h"
+#include "UObject/CoreNet.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Bandwidth of the Keyed Array net serialization, run from the Session Frontend under KeyedArray.Benchmarks.
+ * Sizes are reported as info and checked, since unlike timings they don't depend on the machine.
+ */
+namespace KeyedArrayNetBenchmarks
+{
+	TArray<FName> MakeStatKeys(int32 Num)
+	{
+		TArray<FName> Keys;
+		for (int32 i = 0; i < Num; i++)
+			Keys.Add(FName(*FString::Printf(TEXT("Stat_%d"), i)));
+
+		return Keys;
+	}
+
+	FKeyedArrayValueQuantization MakeQuantization(EKeyedArrayQuantization Mode, float Min = 0.f, float Max = 1.f, int32 NumBits = 16)
+	{
+		FKeyedArrayValueQuantization Quantization;
+		Quantization.Mode = Mode;
+		Quantization.Min = Min;
+		Quantization.Max = Max;
+		Quantization.NumBits = NumBits;
+		return Quantization;
+	}
+
+	/**
+	 * One update of the server to a connection, the way NetDeltaSerialize makes it: the chunk scope picks the pairs,
+	 * and those the connection doesn't have yet are written through their NetSerialize as the Fast Array would, then
+	 * added to the connection's state. Returns the indices of the pairs written.
+	 */
+	TArray<int32> WriteUpdate(UKeyedArrayComponent* Component, TArray<FNameFloatPair>& Pairs, FNetFastTArrayBaseState& ConnectionState, FNetBitWriter& Writer)
+	{
+		FNetDeltaSerializeInfo DeltaParms;
+		DeltaParms.Writer = &Writer;
+		DeltaParms.Object = Component;
+		DeltaParms.OldState = &ConnectionState;
+
+		TArray<int32> Written;
+		FKeyedArrayChunkScope ChunkScope(DeltaParms);
+		ChunkScope.SelectPairs(Pairs);
+		for (int32 i = 0; i < Pairs.Num(); i++)
+		{
+			FNameFloatPair& Pair = Pairs[i];
+			if (ConnectionState.IDToCLMap.Contains(Pair.ReplicationID) || !FKeyedArrayChunkScope::ShouldWrite(Pair))
+				continue;
+
+			bool bSuccess = false;
+			Pair.NetSerialize(Writer, nullptr, bSuccess);
+			ConnectionState.IDToCLMap.Add(Pair.ReplicationID, 0);
+			Written.Add(i);
+		}
+
+		ChunkScope.Finish(true);
+		return Written;
+	}
+
+	/** Reads an update written by WriteUpdate on a client, then calls its OnRep. Returns how many pairs are to come. */
+	int32 ReadUpdate(UNameFloatKAComponent* Component, FNetBitWriter& Writer, int32 NumPairs)
+	{
+		FNetBitReader Reader(nullptr, Writer.GetData(), Writer.GetNumBits());
+		for (int32 i = 0; i < NumPairs; i++)
+		{
+			FNameFloatPair Pair;
+			bool bSuccess = false;
+			Pair.NetSerialize(Reader, nullptr, bSuccess);
+		}
+
+		FNetDeltaSerializeInfo DeltaParms;
+		DeltaParms.Reader = &Reader;
+		DeltaParms.Object = Component;
+
+		FKeyedArrayChunkScope ChunkScope(DeltaParms);
+		ChunkScope.Finish(true);
+
+		Component->ProcessEvent(Component->FindFunctionChecked(TEXT("OnRep_KeyedArray")), nullptr);
+		return ChunkScope.GetNumPairsToCome();
+	}
+}
+
+using namespace KeyedArrayNetBenchmarks;
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKeyedArrayKeyDictionaryBenchmark, "KeyedArray.Benchmarks.KeyDictionary",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKeyedArrayKeyDictionaryBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 NumKeys = 64;
+	const TArray<FName> Keys = MakeStatKeys(NumKeys);
+	const FName UnlistedKey(TEXT("Unlisted"));
+
+	UKeyedArrayKeyDictionary* Dictionary = NewObject<UKeyedArrayKeyDictionary>();
+	Dictionary->SetKeys(Keys);
+
+	// The same keys as regular FNames, then as dictionary indices.
+	FNetBitWriter NameWriter(nullptr, 64 * 1024 * 8);
+	FNetBitWriter DictionaryWriter(nullptr, 64 * 1024 * 8);
+	for (FName Key : Keys)
+	{
+		UPackageMap::StaticSerializeName(NameWriter, Key);
+		Dictionary->SerializeKey(DictionaryWriter, Key);
+	}
+
+	const int64 NameBits = NameWriter.GetNumBits();
+	const int64 DictionaryBits = DictionaryWriter.GetNumBits();
+
+	// Unlisted keys cost a bit more than a regular FName.
+	FName Unlisted = UnlistedKey;
+	FNetBitWriter UnlistedNameWriter(nullptr, 1024 * 8);
+	FNetBitWriter UnlistedDictionaryWriter(nullptr, 1024 * 8);
+	UPackageMap::StaticSerializeName(UnlistedNameWriter, Unlisted);
+	Dictionary->SerializeKey(UnlistedDictionaryWriter, Unlisted);
+
+	AddInfo(FString::Printf(TEXT("%d keys: %.1f bits per key as FNames, %.1f as dictionary indices."),
+		NumKeys, static_cast<double>(NameBits) / NumKeys, static_cast<double>(DictionaryBits) / NumKeys));
+	AddInfo(FString::Printf(TEXT("Unlisted key: %lld bits as an FName, %lld through the dictionary."),
+		UnlistedNameWriter.GetNumBits(), UnlistedDictionaryWriter.GetNumBits()));
+
+	TestTrue(TEXT("Dictionary indices are at most a quarter of the FNames"), DictionaryBits * 4 <= NameBits);
+	TestEqual(TEXT("Unlisted keys cost one more bit"), UnlistedDictionaryWriter.GetNumBits(), UnlistedNameWriter.GetNumBits() + 1);
+
+	FNetBitReader Reader(nullptr, DictionaryWriter.GetData(), DictionaryBits);
+	bool bAllMatch = true;
+	for (FName Key : Keys)
+	{
+		FName ReadKey;
+		Dictionary->SerializeKey(Reader, ReadKey);
+		bAllMatch &= ReadKey == Key;
+	}
+
+	TestTrue(TEXT("Keys read back"), bAllMatch && !Reader.IsError());
+
+	// A receiver with a shorter dictionary fails loudly on keys past its end. The checksum sent ahead of the first
+	// update keeps it from getting that far.
+	UKeyedArrayKeyDictionary* ShortDictionary = NewObject<UKeyedArrayKeyDictionary>();
+	ShortDictionary->SetKeys(MakeStatKeys(NumKeys / 2));
+
+	FNetBitReader ShortReader(nullptr, DictionaryWriter.GetData(), DictionaryBits);
+	for (int32 i = 0; i < NumKeys && !ShortReader.IsError(); i++)
+	{
+		FName ReadKey;
+		ShortDictionary->SerializeKey(ShortReader, ReadKey);
+	}
+
+	TestTrue(TEXT("A mismatched dictionary sets an error"), ShortReader.IsError());
+
+	// The checksum goes ahead of the first update to a connection, and every later update only has a bit for it.
+	FNetBitWriter ChecksumWriter(nullptr, 1024 * 8);
+	Dictionary->SerializeChecksum(ChecksumWriter, true);
+	FNetBitWriter NoChecksumWriter(nullptr, 1024 * 8);
+	Dictionary->SerializeChecksum(NoChecksumWriter, false);
+
+	AddInfo(FString::Printf(TEXT("Dictionary checksum: %lld bits in the first update to a connection, %lld in later ones."),
+		ChecksumWriter.GetNumBits(), NoChecksumWriter.GetNumBits()));
+
+	UKeyedArrayKeyDictionary* SameDictionary = NewObject<UKeyedArrayKeyDictionary>();
+	SameDictionary->SetKeys(MakeStatKeys(NumKeys));
+
+	FNetBitReader SameChecksumReader(nullptr, ChecksumWriter.GetData(), ChecksumWriter.GetNumBits());
+	TestTrue(TEXT("The same dictionary accepts the checksum"), SameDictionary->SerializeChecksum(SameChecksumReader, false));
+
+	FNetBitReader ShortChecksumReader(nullptr, ChecksumWriter.GetData(), ChecksumWriter.GetNumBits());
+	TestFalse(TEXT("A mismatched dictionary refuses the checksum"), ShortDictionary->SerializeChecksum(ShortChecksumReader, false));
+	TestTrue(TEXT("A refused checksum sets an error"), ShortChecksumReader.IsError());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKeyedArrayQuantizationBenchmark, "KeyedArray.Benchmarks.Quantization",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKeyedArrayQuantizationBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 NumValues = 256;
+	TArray<float> Values;
+	for (int32 i = 0; i < NumValues; i++)
+		Values.Add(i * 100.f / (NumValues - 1));
+
+	// Fixed is a range of 0 to 100 with 0.01 precision, as in the FKeyedArrayValueQuantization comment. Half keeps
+	// about 3 significant digits, so is off by up to 0.05 near 100.
+	struct FCase
+	{
+		const TCHAR* Name;
+		FKeyedArrayValueQuantization Quantization;
+		float Precision;
+	};
+
+	const FCase Cases[] = {
+		{ TEXT("None"), MakeQuantization(EKeyedArrayQuantization::None), 0.f },
+		{ TEXT("Half"), MakeQuantization(EKeyedArrayQuantization::Half), 0.05f },
+		{ TEXT("Fixed"), MakeQuantization(EKeyedArrayQuantization::Fixed, 0.f, 100.f, 14), 0.01f }
+	};
+
+	for (const FCase& Case : Cases)
+	{
+		FNetBitWriter Writer(nullptr, 64 * 1024 * 8);
+		for (float Value : Values)
+			Case.Quantization.SerializeValue(Writer, Value);
+
+		const int64 NumBits = Writer.GetNumBits();
+		FNetBitReader Reader(nullptr, Writer.GetData(), NumBits);
+		float MaxError = 0.f;
+		for (float Value : Values)
+		{
+			float ReadValue = 0.f;
+			Case.Quantization.SerializeValue(Reader, ReadValue);
+			MaxError = FMath::Max(MaxError, FMath::Abs(ReadValue - Value));
+		}
+
+		AddInfo(FString::Printf(TEXT("%s: %lld bytes for %d values, largest error %g."), Case.Name, (NumBits + 7) / 8, NumValues, MaxError));
+		TestEqual(FString::Printf(TEXT("%s takes GetNumBits per value"), Case.Name), NumBits, static_cast<int64>(NumValues) * Case.Quantization.GetNumBits());
+		TestTrue(FString::Printf(TEXT("%s keeps its precision"), Case.Name), MaxError <= Case.Precision && !Reader.IsError());
+	}
+
+	// Per-key overrides, picked up from the scope like FastArrayDeltaSerialize would.
+	const TArray<FName> Keys = MakeStatKeys(NumValues);
+	FKeyedArrayNetQuantization NetQuantization;
+	NetQuantization.Default = MakeQuantization(EKeyedArrayQuantization::Half);
+	NetQuantization.PerKey.Add(Keys[0], MakeQuantization(EKeyedArrayQuantization::Fixed, 0.f, 1.f, 8));
+
+	FNetBitWriter Writer(nullptr, 64 * 1024 * 8);
+	{
+		FKeyedArrayNetQuantization::FScope Scope(&NetQuantization);
+		for (int32 i = 0; i < NumValues; i++)
+			KeyedArrayNetSerializeValue(Writer, nullptr, Keys[i], Values[i]);
+	}
+
+	AddInfo(FString::Printf(TEXT("Half with one 8-bit key: %lld bytes for %d values."), (Writer.GetNumBits() + 7) / 8, NumValues));
+	TestEqual(TEXT("Per-key quantization is used"), Writer.GetNumBits(), static_cast<int64>(NumValues - 1) * 16 + 8);
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKeyedArrayChunkBenchmark, "KeyedArray.Benchmarks.Chunks",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKeyedArrayChunkBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 NumPairs = 100;
+	const int32 NumPrioritized = 5;
+	const TArray<FName> Keys = MakeStatKeys(NumPairs);
+
+	TArray<FNameFloatPair> Pairs;
+	for (int32 i = 0; i < NumPairs; i++)
+	{
+		Pairs.Emplace(Keys[i], static_cast<float>(i));
+		Pairs[i].ReplicationID = i;
+	}
+
+	// The last few keys have a priority, so they should be sent before the rest.
+	UNameFloatKAComponent* Server = NewObject<UNameFloatKAComponent>();
+	Server->MaxBytesPerUpdate = 256;
+	for (int32 i = NumPairs - NumPrioritized; i < NumPairs; i++)
+		Server->KeyPriorities.Add(Keys[i], 1);
+
+	UNameFloatKAComponent* Client = NewObject<UNameFloatKAComponent>();
+	FNetFastTArrayBaseState ConnectionState;
+	TArray<TArray<int32>> Updates;
+	int64 MaxUpdateBytes = 0;
+	int32 NumWritten = 0;
+	int32 PairsToCome = 0;
+	bool bSyncedEarly = false;
+	do
+	{
+		FNetBitWriter Writer(nullptr, 64 * 1024 * 8);
+		const TArray<int32> Written = WriteUpdate(Server, Pairs, ConnectionState, Writer);
+		MaxUpdateBytes = FMath::Max(MaxUpdateBytes, (Writer.GetNumBits() + 7) / 8);
+		NumWritten += Written.Num();
+		Updates.Add(Written);
+
+		PairsToCome = ReadUpdate(Client, Writer, Written.Num());
+		TestEqual(TEXT("The client is told how many pairs are still to come"), PairsToCome, NumPairs - NumWritten);
+		bSyncedEarly |= PairsToCome > 0 && Client->IsFullySynced();
+	}
+	while (PairsToCome > 0 && Updates.Num() <= NumPairs);
+
+	AddInfo(FString::Printf(TEXT("%d pairs with MaxBytesPerUpdate %d: %d updates, the largest %lld bytes (without the Fast Array's own header and IDs)."),
+		NumPairs, Server->MaxBytesPerUpdate, Updates.Num(), MaxUpdateBytes));
+
+	// Until a pair has been measured, each one is assumed to take 32 bytes.
+	TestEqual(TEXT("The first update assumes 32 bytes per pair"), Updates[0].Num(), Server->MaxBytesPerUpdate / 32);
+	TestTrue(TEXT("The pairs are split across several updates"), Updates.Num() > 1);
+	TestTrue(TEXT("No update goes over MaxBytesPerUpdate"), MaxUpdateBytes <= Server->MaxBytesPerUpdate);
+	TestEqual(TEXT("Every pair is sent once"), NumWritten, NumPairs);
+
+	bool bPrioritizedFirst = true;
+	for (int32 i = NumPairs - NumPrioritized; i < NumPairs; i++)
+		bPrioritizedFirst &= Updates[0].Contains(i);
+
+	TestTrue(TEXT("The pairs with a priority go in the first update"), bPrioritizedFirst);
+
+	// Without a priority, pairs keep their order: each update picks up where the previous one left off.
+	int32 LastIndex = -1;
+	bool bInOrder = true;
+	for (const TArray<int32>& Update : Updates)
+	{
+		for (const int32 Index : Update)
+		{
+			if (Index >= NumPairs - NumPrioritized)
+				continue;
+
+			bInOrder &= Index > LastIndex;
+			LastIndex = Index;
+		}
+	}
+
+	TestTrue(TEXT("The other pairs are sent in order"), bInOrder);
+	TestFalse(TEXT("The client isn't synced while pairs are to come"), bSyncedEarly);
+	TestTrue(TEXT("The client is synced after the last update"), Client->IsFullySynced());
+
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FKeyedArrayKeyConditionBenchmark, "KeyedArray.Benchmarks.KeyConditions",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FKeyedArrayKeyConditionBenchmark::RunTest(const FString& Parameters)
+{
+	const int32 NumPairs = 64;
+	const int32 NumOwnerOnly = 16;
+	const int32 NumSkipOwner = 16;
+	const int32 NumLookups = NumPairs * 1024;
+	const TArray<FName> Keys = MakeStatKeys(NumPairs);
+
+	TArray<FNameFloatPair> Pairs;
+	for (int32 i = 0; i < NumPairs; i++)
+		Pairs.Emplace(Keys[i], static_cast<float>(i));
+
+	// The first keys are hidden stats of the owner, the next ones are only meant for everyone else.
+	UNameFloatKAComponent* Component = NewObject<UNameFloatKAComponent>();
+	for (int32 i = 0; i < NumOwnerOnly; i++)
+		Component->SetKeyCondition(Keys[i], EKeyedArrayKeyCondition::OwnerOnly);
+
+	for (int32 i = NumOwnerOnly; i < NumOwnerOnly + NumSkipOwner; i++)
+		Component->SetKeyCondition(Keys[i], EKeyedArrayKeyCondition::SkipOwner);
+
+	for (const bool bIsOwner : { true, false })
+	{
+		const FKeyedArrayReplicationConditions::FScope Scope(Component, nullptr, bIsOwner);
+		FNetBitWriter Writer(nullptr, 64 * 1024 * 8);
+		int32 NumSent = 0;
+		bool bFiltered = true;
+		for (int32 i = 0; i < NumPairs; i++)
+		{
+			const bool bSent = FKeyedArrayReplicationConditions::ShouldReplicate(Pairs[i].Key);
+			const bool bMeantFor = i < NumOwnerOnly ? bIsOwner : (i < NumOwnerOnly + NumSkipOwner ? !bIsOwner : true);
+			bFiltered &= bSent == bMeantFor;
+			if (!bSent)
+				continue;
+
+			bool bSuccess = false;
+			Pairs[i].NetSerialize(Writer, nullptr, bSuccess);
+			NumSent++;
+		}
+
+		const TCHAR* ConnectionName = bIsOwner ? TEXT("The owner") : TEXT("Another connection");
+		AddInfo(FString::Printf(TEXT("%s gets %d of %d pairs, %lld bytes."), ConnectionName, NumSent, NumPairs, (Writer.GetNumBits() + 7) / 8));
+		TestTrue(FString::Printf(TEXT("%s only gets the keys meant for it"), ConnectionName), bFiltered);
+		TestEqual(FString::Printf(TEXT("%s misses the keys of the other"), ConnectionName), NumSent, NumPairs - (bIsOwner ? NumSkipOwner : NumOwnerOnly));
+	}
+
+	// Per-key conditions are looked up for every pair, while a Default alone is evaluated once per update.
+	UNameFloatKAComponent* DefaultOnly = NewObject<UNameFloatKAComponent>();
+	DefaultOnly->SetDefaultKeyCondition(EKeyedArrayKeyCondition::SkipOwner);
+	UNameFloatKAComponent* Unconditional = NewObject<UNameFloatKAComponent>();
+
+	auto TimeConditions = [&](const UKeyedArrayComponent* TimedComponent, int32& OutNumSent)
+	{
+		const FKeyedArrayReplicationConditions::FScope Scope(TimedComponent, nullptr, false);
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < NumLookups; i++)
+			OutNumSent += FKeyedArrayReplicationConditions::ShouldReplicate(Keys[i % NumPairs]);
+
+		return (FPlatformTime::Seconds() - StartTime) * 1e9 / NumLookups;
+	};
+
+	int32 NumSent[3] = { 0, 0, 0 };
+	const double PerKeyTime = TimeConditions(Component, NumSent[0]);
+	const double DefaultTime = TimeConditions(DefaultOnly, NumSent[1]);
+	const double UnconditionalTime = TimeConditions(Unconditional, NumSent[2]);
+
+	TestEqual(TEXT("Per-key conditions leave out the owner's keys"), NumSent[0], NumLookups / NumPairs * (NumPairs - NumOwnerOnly));
+	TestEqual(TEXT("SkipOwner by default sends every key to other connections"), NumSent[1], NumLookups);
+	TestEqual(TEXT("Without conditions every key is sent"), NumSent[2], NumLookups);
+
+	AddInfo(FString::Printf(TEXT("ShouldReplicate per pair: per-key conditions %.1f ns, Default only %.1f ns, no conditions %.1f ns"),
+		PerKeyTime, DefaultTime, UnconditionalTime));
+
+	return true;
+}
+
+#endif
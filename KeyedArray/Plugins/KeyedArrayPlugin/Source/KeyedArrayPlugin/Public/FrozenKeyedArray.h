@@ -0,0 +1,442 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "KeyedArrayKeyFuncs.h"
+#include "Misc/Crc.h"
+#include "UObject/NameTypes.h"
+
+/**
+ * The hash Frozen Keyed Arrays build their tables from. It has to be the same in every run, or saved tables would need
+ * rebuilding every time they are loaded. Defaults to the map's key functions, which is stable for integers and enums.
+ * Specialise this for other key types whose GetTypeHash depends on the run (i.e. anything hashing an FName).
+ *
+ * bCheap says whether Get is fast enough to hash every lookup with. If not, the tables are only built and saved, and
+ * lookups go through an index rebuilt from the key functions' hash after loading instead.
+ */
+template<typename KeyType>
+struct TFrozenKeyedArrayKeyHash
+{
+	static constexpr bool bCheap = true;
+
+	static FORCEINLINE uint32 Get(const KeyType& Key)
+	{
+		return TKeyedArrayKeyFuncs<KeyType>::GetKeyHash(Key);
+	}
+};
+
+/**
+ * FName hashes its comparison index, which depends on the order names were created in, so this hashes the name itself
+ * instead. It is lowercased since FNames compare case-insensitively and whichever case was created first is the one
+ * stored. Copying and hashing the string is far slower than a TMap lookup, so it isn't used for lookups.
+ */
+template<>
+struct TFrozenKeyedArrayKeyHash<FName>
+{
+	static constexpr bool bCheap = false;
+
+	static uint32 Get(const FName& Key)
+	{
+		TCHAR Name[NAME_SIZE];
+		Key.GetComparisonNameEntry()->GetName(Name);
+		for (TCHAR* Char = Name; *Char; Char++)
+			*Char = FChar::ToLower(*Char);
+
+		return HashCombine(FCrc::StrCrc32(Name), static_cast<uint32>(Key.GetNumber()));
+	}
+};
+
+/**
+ * Minimal perfect hash over a fixed set of keys, used by Frozen Keyed Arrays.
+ *
+ * Every key is first hashed into a bucket. Each bucket stores a seed, found when building, that sends every key of
+ * the bucket to a slot no other key uses. There are exactly as many slots as keys, and every slot stores the index
+ * of its pair, so a lookup is a key hash, two array loads and a single key comparison regardless of whether the key
+ * exists.
+ *
+ * If two different keys share a hash no seed can tell them apart, and a set of keys may need more seeds than worth
+ * trying. Either way the tables fall back to the hashes in sorted order (stored in Seeds, one per slot) with the index
+ * of their pair in Slots, for a binary search instead.
+ *
+ * The tables are plain arrays so they can be serialized with the asset owning them, making loading free of any
+ * building. Hashes come from TFrozenKeyedArrayKeyHash, which is stable across runs, so IsValid only fails when loaded
+ * if the key hashing itself changed.
+ *
+ * Keys whose stable hash isn't cheap (see TFrozenKeyedArrayKeyHash::bCheap) are looked up through a runtime index
+ * instead: an open addressing table of pair indices, hashed with the key functions and rebuilt in O(n) after loading.
+ */
+template<typename KeyType, typename PairType>
+struct TFrozenKeyedArrayHash
+{
+	typedef TKeyedArrayKeyFuncs<KeyType> KeyFuncsType;
+
+	/** Average number of keys per bucket. Fewer means more seeds to store, more means longer to build. */
+	static constexpr int32 KeysPerBucket = 2;
+
+	/** Whether lookups go through the saved tables rather than the runtime index. */
+	static constexpr bool bLookupWithTables = TFrozenKeyedArrayKeyHash<KeyType>::bCheap;
+
+	static FORCEINLINE uint32 GetKeyHash(const KeyType& Key)
+	{
+		return TFrozenKeyedArrayKeyHash<KeyType>::Get(Key);
+	}
+
+	/** Scrambles the key's hash with the bucket's seed. */
+	static FORCEINLINE uint32 Mix(uint32 Hash, uint32 Seed)
+	{
+		Hash ^= Seed * 0x9E3779B9u;
+		Hash ^= Hash >> 16;
+		Hash *= 0x85EBCA6Bu;
+		Hash ^= Hash >> 13;
+		Hash *= 0xC2B2AE35u;
+		Hash ^= Hash >> 16;
+		return Hash;
+	}
+
+	/** Whether the tables are the sorted fallback rather than the perfect hash. There are fewer buckets than keys. */
+	static FORCEINLINE bool IsSorted(const TArray<uint32>& Seeds, const TArray<int32>& Slots)
+	{
+		return Slots.Num() > 1 && Seeds.Num() == Slots.Num();
+	}
+
+	/** Returns the index of the pair with the given key, or -1 if there is none. */
+	static FORCEINLINE int32 GetIndex(const TArray<PairType>& Pairs, const TArray<uint32>& Seeds, const TArray<int32>& Slots, const KeyType& Key)
+	{
+		if (Pairs.Num() == 0)
+			return -1;
+
+		const uint32 Hash = GetKeyHash(Key);
+		if (IsSorted(Seeds, Slots))
+			return GetSortedIndex(Pairs, Seeds, Slots, Key, Hash);
+
+		const uint32 Seed = Seeds[Hash % static_cast<uint32>(Seeds.Num())];
+		const int32 Index = Slots[Mix(Hash, Seed) % static_cast<uint32>(Slots.Num())];
+		if (KeyFuncsType::Matches(Pairs[Index].Key, Key))
+			return Index;
+
+		return -1;
+	}
+
+	/** Returns the index of the pair with the given key in the runtime index, or -1 if there is none. */
+	static FORCEINLINE int32 GetRuntimeIndex(const TArray<PairType>& Pairs, const TArray<int32>& RuntimeIndex, const KeyType& Key)
+	{
+		if (RuntimeIndex.Num() == 0)
+			return -1;
+
+		const uint32 Mask = static_cast<uint32>(RuntimeIndex.Num() - 1);
+		for (uint32 Slot = KeyFuncsType::GetKeyHash(Key) & Mask; RuntimeIndex[Slot] != INDEX_NONE; Slot = (Slot + 1) & Mask)
+			if (KeyFuncsType::Matches(Pairs[RuntimeIndex[Slot]].Key, Key))
+				return RuntimeIndex[Slot];
+
+		return -1;
+	}
+
+	/** Fills the runtime index, at most half full so probes stay short. The keys must be unique. */
+	static void BuildRuntimeIndex(const TArray<PairType>& Pairs, TArray<int32>& OutRuntimeIndex)
+	{
+		OutRuntimeIndex.Reset();
+		if (Pairs.Num() == 0)
+			return;
+
+		OutRuntimeIndex.Init(INDEX_NONE, static_cast<int32>(FMath::RoundUpToPowerOfTwo(Pairs.Num() * 2)));
+		const uint32 Mask = static_cast<uint32>(OutRuntimeIndex.Num() - 1);
+		for (int32 i = 0; i < Pairs.Num(); i++)
+		{
+			uint32 Slot = KeyFuncsType::GetKeyHash(Pairs[i].Key) & Mask;
+			while (OutRuntimeIndex[Slot] != INDEX_NONE)
+				Slot = (Slot + 1) & Mask;
+
+			OutRuntimeIndex[Slot] = i;
+		}
+	}
+
+	/** Whether every key can be found through the tables. */
+	static bool IsValid(const TArray<PairType>& Pairs, const TArray<uint32>& Seeds, const TArray<int32>& Slots)
+	{
+		if (Pairs.Num() == 0)
+			return Slots.Num() == 0;
+
+		if (Slots.Num() != Pairs.Num() || Seeds.Num() == 0)
+			return false;
+
+		for (int32 i = 0; i < Pairs.Num(); i++)
+			if (GetIndex(Pairs, Seeds, Slots, Pairs[i].Key) != i)
+				return false;
+
+		return true;
+	}
+
+	/**
+	 * Builds the tables for the pairs. Returns false, leaving the tables empty, if any key is duplicated.
+	 * Buckets are placed from the largest to the smallest, since those are the hardest to find free slots for.
+	 */
+	static bool Build(const TArray<PairType>& Pairs, TArray<uint32>& OutSeeds, TArray<int32>& OutSlots)
+	{
+		OutSeeds.Reset();
+		OutSlots.Reset();
+
+		const int32 NumPairs = Pairs.Num();
+		if (NumPairs == 0)
+			return true;
+
+		TArray<uint32> Hashes;
+		Hashes.SetNumUninitialized(NumPairs);
+		for (int32 i = 0; i < NumPairs; i++)
+			Hashes[i] = GetKeyHash(Pairs[i].Key);
+
+		const int32 NumBuckets = FMath::Max(1, NumPairs / KeysPerBucket);
+		TArray<TArray<int32>> Buckets;
+		Buckets.SetNum(NumBuckets);
+		bool bHashesCollide = false;
+		for (int32 i = 0; i < NumPairs; i++)
+		{
+			// Keys with the same hash always share a bucket, so this finds both duplicates and collisions.
+			TArray<int32>& Bucket = Buckets[Hashes[i] % static_cast<uint32>(NumBuckets)];
+			for (const int32 OtherIndex : Bucket)
+			{
+				if (KeyFuncsType::Matches(Pairs[OtherIndex].Key, Pairs[i].Key))
+				{
+					OutSeeds.Reset();
+					OutSlots.Reset();
+					return false;
+				}
+
+				bHashesCollide |= Hashes[OtherIndex] == Hashes[i];
+			}
+
+			Bucket.Add(i);
+		}
+
+		if (bHashesCollide)
+		{
+			BuildSorted(Hashes, OutSeeds, OutSlots);
+			return true;
+		}
+
+		TArray<int32> BucketOrder;
+		BucketOrder.Reserve(NumBuckets);
+		for (int32 i = 0; i < NumBuckets; i++)
+			if (Buckets[i].Num() > 0)
+				BucketOrder.Add(i);
+
+		BucketOrder.Sort([&Buckets](const int32 A, const int32 B)
+		{
+			return Buckets[A].Num() > Buckets[B].Num();
+		});
+
+		OutSeeds.Init(0, NumBuckets);
+		OutSlots.Init(INDEX_NONE, NumPairs);
+
+		// Seeds tried per bucket before giving up on the perfect hash. The last buckets are left with few free slots,
+		// so the number of seeds they may need grows with the keys.
+		const uint32 MaxSeed = FMath::Max(1u << 16, static_cast<uint32>(NumPairs) * 16);
+
+		TArray<int32> BucketSlots;
+		for (const int32 BucketIndex : BucketOrder)
+		{
+			const TArray<int32>& Bucket = Buckets[BucketIndex];
+
+			uint32 Seed = 1;
+			for (; Seed <= MaxSeed; Seed++)
+			{
+				BucketSlots.Reset();
+				for (const int32 Index : Bucket)
+				{
+					const int32 Slot = Mix(Hashes[Index], Seed) % static_cast<uint32>(NumPairs);
+					if (OutSlots[Slot] != INDEX_NONE || BucketSlots.Contains(Slot))
+						break;
+
+					BucketSlots.Add(Slot);
+				}
+
+				if (BucketSlots.Num() == Bucket.Num())
+				{
+					for (int32 i = 0; i < Bucket.Num(); i++)
+						OutSlots[BucketSlots[i]] = Bucket[i];
+
+					OutSeeds[BucketIndex] = Seed;
+					break;
+				}
+			}
+
+			if (Seed > MaxSeed)
+			{
+				BuildSorted(Hashes, OutSeeds, OutSlots);
+				return true;
+			}
+		}
+
+		return true;
+	}
+
+private:
+	/** Stores the hashes in sorted order in OutSeeds, along with the index of their pair in OutSlots. */
+	static void BuildSorted(const TArray<uint32>& Hashes, TArray<uint32>& OutSeeds, TArray<int32>& OutSlots)
+	{
+		OutSlots.SetNumUninitialized(Hashes.Num());
+		for (int32 i = 0; i < Hashes.Num(); i++)
+			OutSlots[i] = i;
+
+		OutSlots.Sort([&Hashes](const int32 A, const int32 B)
+		{
+			return Hashes[A] < Hashes[B];
+		});
+
+		OutSeeds.SetNumUninitialized(Hashes.Num());
+		for (int32 i = 0; i < Hashes.Num(); i++)
+			OutSeeds[i] = Hashes[OutSlots[i]];
+	}
+
+	static int32 GetSortedIndex(const TArray<PairType>& Pairs, const TArray<uint32>& Hashes, const TArray<int32>& Slots, const KeyType& Key, uint32 Hash)
+	{
+		int32 First = 0;
+		int32 Count = Hashes.Num();
+		while (Count > 0)
+		{
+			const int32 Step = Count / 2;
+			if (Hashes[First + Step] < Hash)
+			{
+				First += Step + 1;
+				Count -= Step + 1;
+			}
+			else
+			{
+				Count = Step;
+			}
+		}
+
+		for (; First < Hashes.Num() && Hashes[First] == Hash; First++)
+			if (KeyFuncsType::Matches(Pairs[Slots[First]].Key, Key))
+				return Slots[First];
+
+		return -1;
+	}
+};
+
+/**
+ * Every non-reflected member and method of a Frozen Keyed Array: a read-only Keyed Array built once from a regular
+ * one, i.e. for tables filled from data assets.
+ * Pairs, Seeds and Slots have to be declared as UPROPERTYs by the Frozen Keyed Array itself so the hash is saved
+ * along with the pairs. Leaves the access as public.
+ */
+#define FROZEN_KEYED_ARRAY_BODY(StructName, KeyTypeName, ValueTypeName, PairName, KeyedArrayName) \
+public: \
+	typedef KeyTypeName KeyType; \
+	typedef ValueTypeName ValueType; \
+	typedef PairName PairType; \
+	typedef TFrozenKeyedArrayHash<KeyType, PairType> HashType; \
+	\
+	StructName() \
+	{ \
+	} \
+	\
+	explicit StructName(const KeyedArrayName& KeyedArray) \
+	{ \
+		Freeze(KeyedArray.GetData()); \
+	} \
+	\
+	/** Replaces every pair and builds the perfect hash for them. The keys must be unique. */ \
+	void Freeze(TArrayView<const PairType> NewPairs) \
+	{ \
+		Pairs.Reset(NewPairs.Num()); \
+		Pairs.Append(NewPairs.GetData(), NewPairs.Num()); \
+		verifyf(HashType::Build(Pairs, Seeds, Slots), TEXT("A Frozen Keyed Array can't have duplicate keys.")); \
+		if (!HashType::bLookupWithTables) \
+			HashType::BuildRuntimeIndex(Pairs, RuntimeIndex); \
+	} \
+	\
+	/** \
+	 * The hash is saved with the pairs, so this is only a check unless the key hashing has changed since. Keys looked \
+	 * up through the runtime index skip the check, which would hash every key the slow way, and rebuild the index. \
+	 */ \
+	void PostSerialize(const FArchive& Ar) \
+	{ \
+		if (!Ar.IsLoading()) \
+			return; \
+		\
+		if (!HashType::bLookupWithTables) \
+			HashType::BuildRuntimeIndex(Pairs, RuntimeIndex); \
+		else if (!HashType::IsValid(Pairs, Seeds, Slots)) \
+			HashType::Build(Pairs, Seeds, Slots); \
+	} \
+	\
+	FORCEINLINE int32 GetIndex(const KeyType& Key) const \
+	{ \
+		if (!HashType::bLookupWithTables) \
+			return HashType::GetRuntimeIndex(Pairs, RuntimeIndex, Key); \
+		\
+		return HashType::GetIndex(Pairs, Seeds, Slots, Key); \
+	} \
+	\
+	FORCEINLINE bool Contains(const KeyType& Key) const \
+	{ \
+		return GetIndex(Key) > -1; \
+	} \
+	\
+	FORCEINLINE const PairType* GetPairAsPointer(const KeyType& Key) const \
+	{ \
+		const int32 Index = GetIndex(Key); \
+		if (Index > -1) \
+			return &Pairs[Index]; \
+		\
+		return nullptr; \
+	} \
+	\
+	FORCEINLINE const ValueType* GetAsPointer(const KeyType& Key) const \
+	{ \
+		const PairType* Pair = GetPairAsPointer(Key); \
+		if (Pair) \
+			return &Pair->Value; \
+		\
+		return nullptr; \
+	} \
+	\
+	/** \
+	 * Returns a copy so should only be used for small data types. \
+	 */ \
+	FORCEINLINE ValueType GetSafe(const KeyType& Key) const \
+	{ \
+		const ValueType* Value = GetAsPointer(Key); \
+		if (Value) \
+			return *Value; \
+		\
+		return ValueType(); \
+	} \
+	\
+	FORCEINLINE const ValueType& operator[](const KeyType& Key) const \
+	{ \
+		const ValueType* Value = GetAsPointer(Key); \
+		check(Value); \
+		return *Value; \
+	} \
+	\
+	FORCEINLINE const PairType& GetPair(int32 Index) const \
+	{ \
+		return Pairs[Index]; \
+	} \
+	\
+	FORCEINLINE int32 Num() const \
+	{ \
+		return Pairs.Num(); \
+	} \
+	\
+	FORCEINLINE const TArray<PairType>& GetData() const \
+	{ \
+		return Pairs; \
+	} \
+	\
+private: \
+	/** Pair indices hashed with the key functions, when the stable hash is too slow to look keys up with. */ \
+	TArray<int32> RuntimeIndex; \
+	\
+public:
+
+/** Has to follow every Frozen Keyed Array so the hash gets checked after loading. */
+#define FROZEN_KEYED_ARRAY_TYPE_TRAITS(StructName) \
+template<> \
+struct TStructOpsTypeTraits<StructName> : public TStructOpsTypeTraitsBase2<StructName> \
+{ \
+	enum \
+	{ \
+		WithPostSerialize = true, \
+	}; \
+};
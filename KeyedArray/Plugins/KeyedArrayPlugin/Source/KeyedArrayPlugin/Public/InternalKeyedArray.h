@@ -1,16 +1,24 @@
 ﻿#pragma once
 
 #include "CoreTypes.h"
+#include "KeyedArrayKeyFuncs.h"
+#include "KeyedArrayFlatMap.h"
+#include "KeyedArrayValueIndex.h"
 
 /**
  * This class is responsible for most of the logic required for Keyed Arrays.
  * Ideally, this class shouldn't exist but Unreal mean and doesn't allow generic USTRUCTs nor inheritance from non-USTRUCTs.
+ *
+ * MapType is the key policy, translating keys into indices. It defaults to a TMap but can be anything implementing
+ * the same subset of its interface, such as TKeyedArrayDirectMap for dense integer keys, TKeyedArrayFlatMap or
+ * TKeyedArraySmallMap for arrays that usually hold only a few keys.
+ * AllocatorType is the allocator of the pairs array. Keyed Array USTRUCTs can only use the default one since their
+ * pairs are a UPROPERTY, but non-reflected pairs can be stored inline with i.e. TInlineAllocator.
  */
-template<typename KeyType, typename ValueType, typename PairType>
+template<typename KeyType, typename ValueType, typename PairType, typename MapType = TKeyedArrayMap<KeyType>, typename AllocatorType = FDefaultAllocator>
 class TInternalKeyedArray
 {
-	typedef TArray<PairType> ArrayType;
-	typedef TMap<KeyType, int32> MapType;
+	typedef TArray<PairType, AllocatorType> ArrayType;
 	typedef TTuple<KeyType, int32> KeyValuePairAsTuple;
 
 protected:
@@ -19,6 +27,31 @@ protected:
 
 	TArray<KeyType> OldKeys;
 
+	/** Slots emptied by the last replicated removal. Pairs only get moved into them after the map was notified. */
+	TArray<int32> PendingRemovedIndices;
+	bool bPendingRebuild;
+
+	/** Whether the replicated update being received added or removed any key. */
+	bool bPendingKeysChanged;
+
+	/** Set once a replicated update was received, i.e. this is a client's copy of the pairs. */
+	bool bReceivedReplication;
+
+	/**
+	 * Bumped whenever a key is added, removed or moved to another index. Owned by the Keyed Array so it's copied
+	 * along with the pairs, but never replicated.
+	 */
+	uint32* KeyGeneration;
+
+	/** The KeyGeneration the map was last known to be in sync with. */
+	uint32 CleanKeyGeneration;
+
+	/**
+	 * Optional reverse lookup of keys by value, only allocated while enabled.
+	 * It isn't part of the Keyed Array's data so it is never serialized nor replicated.
+	 */
+	TKeyedArrayValueIndexPtr<KeyType, ValueType> ValueIndex;
+
 	
 public:
 	virtual ~TInternalKeyedArray() = default;
@@ -27,42 +60,161 @@ public:
 	{
 		Array = nullptr;
 		Map = nullptr;
+		bPendingRebuild = false;
+		bPendingKeysChanged = false;
+		bReceivedReplication = false;
+		KeyGeneration = nullptr;
+		CleanKeyGeneration = 0;
 	}
 	
-	TInternalKeyedArray(ArrayType* NewArray, MapType* NewMap)
+	TInternalKeyedArray(ArrayType* NewArray, MapType* NewMap, uint32* NewKeyGeneration = nullptr)
 	{
 		Array = NewArray;
 		Map = NewMap;
+		bPendingRebuild = false;
+		bPendingKeysChanged = false;
+		bReceivedReplication = false;
+		KeyGeneration = NewKeyGeneration;
+		BindKeyedArrayMap(Map, Array);
+
+		// Make sure the first Clean always validates the map.
+		CleanKeyGeneration = KeyGeneration ? *KeyGeneration - 1 : 0;
+	}
+
+	/**
+	 * Points this at another Keyed Array's storage. Needed whenever the Keyed Array owning the storage is copied, as
+	 * the copied pointers would otherwise still refer to the original's storage.
+	 */
+	void Rebind(ArrayType* NewArray, MapType* NewMap, uint32* NewKeyGeneration)
+	{
+		Array = NewArray;
+		Map = NewMap;
+		KeyGeneration = NewKeyGeneration;
+		BindKeyedArrayMap(Map, Array);
+	}
+
+	/**
+	 * Call whenever the array or the map were replaced as a whole rather than through this (i.e. deserialized or
+	 * swapped for pooled storage). The generation is bumped without marking the map clean, as a replaced array could
+	 * carry any generation, including the one the map was last clean at.
+	 */
+	FORCEINLINE void OnStorageReplaced()
+	{
+		if (KeyGeneration)
+		{
+			(*KeyGeneration)++;
+			CleanKeyGeneration = *KeyGeneration - 1;
+		}
 	}
 
 
 protected:
-	FORCEINLINE int32 UpdateValue(const KeyType Key, const ValueType& Item)
+	FORCEINLINE int32 UpdateValue(int32 Index, const ValueType& Item)
 	{
 		// Doesn't do any checks so yeah.
-		int32 Index = GetIndex(Key);
-		(*Array)[Index] = PairType(Key, Item);
+		PairType& Pair = (*Array)[Index];
+		Pair.Value = Item;
+		IndexValue(Pair.Key, Pair.Value);
 		return Index;
 	}
+
+	/** Points the value index at the key's current value. Does nothing if the value index isn't enabled. */
+	FORCEINLINE void IndexValue(const KeyType& Key, const ValueType& Item)
+	{
+		if (ValueIndex.IsValid())
+			ValueIndex->Index(Key, Item);
+	}
+
+	FORCEINLINE void UnindexValue(const KeyType& Key)
+	{
+		if (ValueIndex.IsValid())
+			ValueIndex->Unindex(Key);
+	}
+
+	/**
+	 * Finds or adds the map entry for the key with a single hash lookup.
+	 * bOutAdded tells whether the entry is new, in which case the caller must assign it the index of the new pair.
+	 */
+	FORCEINLINE int32& FindOrAddIndex(const KeyType& Key, bool& bOutAdded)
+	{
+		const int32 NumBefore = Map->Num();
+		int32& Index = Map->FindOrAdd(Key);
+		bOutAdded = Map->Num() != NumBefore;
+		if (bOutAdded)
+			OnKeysChanged();
+		
+		return Index;
+	}
+
+	/**
+	 * Call whenever a key has been added, removed or moved locally. The map is maintained alongside every local
+	 * change so it stays in sync with the new generation.
+	 */
+	FORCEINLINE void OnKeysChanged()
+	{
+		if (KeyGeneration)
+		{
+			(*KeyGeneration)++;
+			CleanKeyGeneration = *KeyGeneration;
+		}
+	}
+
+	/** The map is known to match the array as of the current KeyGeneration. */
+	FORCEINLINE void MarkClean()
+	{
+		if (KeyGeneration)
+			CleanKeyGeneration = *KeyGeneration;
+	}
 	
 	FORCEINLINE void AddToMap(const KeyType& Key, int32 Index)
 	{
 		Map->Add(Key, Index);
+		OnKeysChanged();
 	}
 
 	FORCEINLINE void RemoveFromMap(const KeyType& Key)
 	{
-		const int32 Index = (*Map)[Key];
-		Map->Remove(Key);
+		int32 Index;
+		if (Map->RemoveAndCopyValue(Key, Index))
+		{
+			UnindexValue(Key);
+			DecrementMap(Index + 1);
+			OnKeysChanged();
+		}
+	}
+
+	/**
+	 * Removes the pair at Index and shifts the index of every pair after it.
+	 * The key is read straight from the array so no reverse lookup of the map is needed.
+	 */
+	FORCEINLINE void RemoveAtFromMap(int32 Index)
+	{
+		UnindexValue((*Array)[Index].Key);
+		Map->Remove((*Array)[Index].Key);
+		Array->RemoveAt(Index);
 		DecrementMap(Index + 1);
+		OnKeysChanged();
 	}
 
-	/** This operation is O(n) so don't use if not necessary. */
-	FORCEINLINE void RemoveFromMap(int32 Index)
+	/**
+	 * Moves the last pair into the hole left at Index, so only the moved pair's map entry needs patching.
+	 * Doesn't preserve order.
+	 */
+	FORCEINLINE void RemoveAtSwapFromMap(int32 Index)
 	{
-		const KeyType* Key = Map->FindKey(Index);
-		if (Key != nullptr)
-			Map->Remove(*Key);
+		const int32 LastIndex = Array->Num() - 1;
+		UnindexValue((*Array)[Index].Key);
+		Map->Remove((*Array)[Index].Key);
+		SwapLastInto(Index, LastIndex);
+	}
+
+	FORCEINLINE void SwapLastInto(int32 Index, int32 LastIndex)
+	{
+		if (Index != LastIndex)
+			Map->FindChecked((*Array)[LastIndex].Key) = Index;
+
+		Array->RemoveAtSwap(Index);
+		OnKeysChanged();
 	}
 
 	FORCEINLINE bool ContainsKey(const KeyType& Key) const
@@ -70,6 +222,50 @@ protected:
 		return Map->Contains(Key);
 	}
 
+	/** Adds the pair or updates its value, then calls OnPairWritten(Index, bAdded). */
+	template<typename CallbackType>
+	FORCEINLINE bool AddOrUpdate(const KeyType& Key, const ValueType& Item, CallbackType& OnPairWritten)
+	{
+		bool bAdded;
+		int32& Index = FindOrAddIndex(Key, bAdded);
+		if (bAdded)
+		{
+			Index = Array->Add(PairType(Key, Item));
+			IndexValue(Key, Item);
+		}
+		else
+			UpdateValue(Index, Item);
+
+		OnPairWritten(Index, bAdded);
+		return bAdded;
+	}
+
+	/**
+	 * Removes every flagged pair while keeping the order of the rest.
+	 * Every kept pair after the first removed one is moved down once and has its index fixed up in the same pass,
+	 * rather than shifting the whole map for every removal.
+	 * The flagged keys must already have been removed from the map.
+	 */
+	void CompactRemoved(const TBitArray<>& RemovedFlags, int32 FirstRemovedIndex)
+	{
+		int32 WriteIndex = FirstRemovedIndex;
+		for (int32 ReadIndex = FirstRemovedIndex; ReadIndex < Array->Num(); ReadIndex++)
+		{
+			if (RemovedFlags[ReadIndex])
+				continue;
+
+			// Patched before moving, while the pair is still where the map says it is.
+			Map->FindChecked((*Array)[ReadIndex].Key) = WriteIndex;
+			if (WriteIndex != ReadIndex)
+				(*Array)[WriteIndex] = MoveTemp((*Array)[ReadIndex]);
+
+			WriteIndex++;
+		}
+
+		Array->SetNum(WriteIndex, false);
+		OnKeysChanged();
+	}
+
 public:
 	virtual void IncrementMap(int32 StartingIndex)
 	{
@@ -79,9 +275,10 @@ public:
 
 		// Resort map.
 		// For every key with a index above the inserted index, increment their index by 1.
-		for (auto KeyValue : *this->Map)
+		// Written through the iterator so no key gets hashed again.
+		for (auto&& KeyValue : *this->Map)
 			if (KeyValue.Value >= StartingIndex)
-				(*this->Map)[KeyValue.Key] = KeyValue.Value + 1;
+				KeyValue.Value++;
 	}
 
 	virtual void DecrementMap(int32 StartingIndex)
@@ -92,9 +289,9 @@ public:
 		
 		// Resort map.
 		// For every key with a index above the inserted index, decrement their index by 1.
-		for (auto KeyValue : *this->Map)
+		for (auto&& KeyValue : *this->Map)
 			if (KeyValue.Value >= StartingIndex)
-				(*this->Map)[KeyValue.Key] = KeyValue.Value - 1;
+				KeyValue.Value--;
 	}
 
 	TArray<KeyType>& GetOldKeys()
@@ -114,63 +311,298 @@ public:
 
 	void OnKeyRemoved(int32 Index, const KeyType Key)
 	{
-		RemoveFromMap(Key, Index);
+		RemoveFromMap(Key);
+	}
+
+	/**
+	 * Checks the map against the array and rebuilds it if any key is missing or points to the wrong index.
+	 * Skipped while the KeyGeneration is the one the map was last clean at, so changes made to the array directly
+	 * have to be followed by OnStorageReplaced or Rebuild. Returns whether a rebuild happened.
+	 */
+	bool Clean()
+	{
+		// Under normal circumstances, it will usually be the values that change, not the keys.
+		// If the generation hasn't moved since the map was last in sync, the keys can't have changed either.
+		if (KeyGeneration && *KeyGeneration == CleanKeyGeneration && Map->Num() == Array->Num())
+			return false;
+		
+		// Don't bother rebuilding if they keys haven't changed.
+		if (Map->Num() == Array->Num())
+		{
+			for (int32 i = 0; i < Array->Num(); i++)
+			{
+				const int32* Index = Map->Find((*Array)[i].Key);
+				if (!Index || *Index != i)
+				{
+					// Key cannot be found = new = dirty.
+					// Index for key has changed = dirty.
+					Rebuild();
+					return true;
+				}
+			}
+
+			MarkClean();
+			return false;
+		}
+
+		Rebuild();
+		return true;
+	}
+
+	/**
+	 * Forcefully refreshes the map based entirely on the array data. This is expensive as it's O(n).
+	 */
+	void Rebuild()
+	{
+		Map->Empty(Array->Num());
+
+		for (int32 i = 0; i < Array->Num(); i++)
+			Map->Add((*Array)[i].Key, i);
+
+		RebuildValueIndex();
+
+		MarkClean();
+	}
+
+	/**
+	 * Enables or disables the value index, which makes finding keys by value O(1) at the cost of keeping a second
+	 * map up-to-date on every add, update and removal. Enabling it allocates the index and builds it from the current
+	 * pairs, disabling it frees it.
+	 * ValueIndexType is only instantiated here, so values only need GetTypeHash for Keyed Arrays that enable it.
+	 */
+	template<typename ValueIndexType = TKeyedArrayValueIndex<KeyType, ValueType>>
+	void SetValueIndexEnabled(bool bEnabled)
+	{
+		if (ValueIndex.IsValid() == bEnabled)
+			return;
+
+		if (bEnabled)
+		{
+			ValueIndex.Reset(new ValueIndexType());
+			RebuildValueIndex();
+		}
+		else
+		{
+			ValueIndex.Reset();
+		}
+	}
+
+	FORCEINLINE bool IsValueIndexEnabled() const
+	{
+		return ValueIndex.IsValid();
+	}
+
+	/**
+	 * Refreshes the value index based entirely on the array data. Only needed if values were changed without going
+	 * through the Keyed Array, as Rebuild already takes care of it.
+	 */
+	void RebuildValueIndex()
+	{
+		if (!ValueIndex.IsValid())
+			return;
+
+		ValueIndex->Reset(Array->Num());
+		for (const PairType& Pair : *Array)
+			ValueIndex->Index(Pair.Key, Pair.Value);
+	}
+
+	/**
+	 * Returns the lowest index holding the value, or -1 if there is none. Requires the value index to be enabled.
+	 * Every candidate is checked against the array, so a stale entry can never produce a wrong index.
+	 */
+	int32 FindFirstIndexByValue(const ValueType& Item) const
+	{
+		check(ValueIndex.IsValid());
+
+		int32 FirstIndex = -1;
+		ValueIndex->ForEachKey(Item, [this, &Item, &FirstIndex](const KeyType& Key)
+		{
+			const int32* Index = Map->Find(Key);
+			if (Index && (*Array)[*Index].Value == Item && (FirstIndex < 0 || *Index < FirstIndex))
+				FirstIndex = *Index;
+		});
+
+		return FirstIndex;
+	}
+
+	/**
+	 * Fast Array replication callbacks. Rather than rebuilding the map, they patch it pair by pair.
+	 * The Fast Array notifies removals before adds and changes, but only removes the pairs (using RemoveAtSwap)
+	 * after every callback was made. The pairs moved into the emptied slots are therefore patched in
+	 * PostReplicatedReceive.
+	 */
+	void PreReplicatedRemove(const TArrayView<int32>& RemovedIndices)
+	{
+		for (const int32 Index : RemovedIndices)
+		{
+			UnindexValue((*Array)[Index].Key);
+			Map->Remove((*Array)[Index].Key);
+		}
+
+		PendingRemovedIndices.Append(RemovedIndices.GetData(), RemovedIndices.Num());
+		bPendingKeysChanged |= RemovedIndices.Num() > 0;
+	}
+
+	void PostReplicatedAdd(const TArrayView<int32>& AddedIndices)
+	{
+		for (const int32 Index : AddedIndices)
+		{
+			Map->Add((*Array)[Index].Key, Index);
+			IndexValue((*Array)[Index].Key, (*Array)[Index].Value);
+		}
+
+		bPendingKeysChanged |= AddedIndices.Num() > 0;
+	}
+
+	void PostReplicatedChange(const TArrayView<int32>& ChangedIndices)
+	{
+		// Keys of existing pairs are never meant to change, but if one did, the old key is gone so a rebuild is
+		// the only way to get rid of it.
+		for (const int32 Index : ChangedIndices)
+		{
+			const int32* MappedIndex = Map->Find((*Array)[Index].Key);
+			if (!MappedIndex || *MappedIndex != Index)
+				bPendingRebuild = true;
+			else
+				IndexValue((*Array)[Index].Key, (*Array)[Index].Value);
+		}
+	}
+
+	/**
+	 * Points the map at the pairs the Fast Array moved into the emptied slots. It removes the pairs with RemoveAtSwap
+	 * from the highest index down, so the moves are replayed from the removed indices and the old size to know which
+	 * pair ended up in each slot. Only the map entries of those pairs are touched, found by their old index, so this
+	 * works for maps that read keys from the (already moved) pairs too.
+	 */
+	void PatchMovedPairs()
+	{
+		const int32 NumRemoved = PendingRemovedIndices.Num();
+		if (NumRemoved == 0)
+			return;
+
+		PendingRemovedIndices.Sort();
+
+		// Old index of the pair moved into each removed slot, or INDEX_NONE if the slot was the last one.
+		TArray<int32, TInlineAllocator<16>> MovedFrom;
+		MovedFrom.SetNumUninitialized(NumRemoved);
+
+		int32 Num = Array->Num() + NumRemoved;
+		int32 Filled = NumRemoved - 1;
+		for (int32 i = NumRemoved - 1; i >= 0; i--, Num--)
+		{
+			const int32 Last = Num - 1;
+			if (Last == PendingRemovedIndices[i])
+			{
+				MovedFrom[i] = INDEX_NONE;
+				continue;
+			}
+
+			// The last pair may itself have been moved there by an earlier removal.
+			while (PendingRemovedIndices[Filled] > Last)
+				Filled--;
+
+			MovedFrom[i] = PendingRemovedIndices[Filled] == Last ? MovedFrom[Filled] : Last;
+		}
+
+		for (int32 i = 0; i < NumRemoved && PendingRemovedIndices[i] < Array->Num(); i++)
+			ReindexKeyedArrayMap(Map, (*Array)[PendingRemovedIndices[i]].Key, MovedFrom[i], PendingRemovedIndices[i]);
+	}
+
+	void PostReplicatedReceive()
+	{
+		// The KeyGeneration isn't part of what the Fast Array sends, so clients keep their own.
+		if (bPendingKeysChanged && KeyGeneration)
+			(*KeyGeneration)++;
+
+		if (bPendingRebuild)
+		{
+			Rebuild();
+			bPendingRebuild = false;
+		}
+		else
+		{
+			PatchMovedPairs();
+			MarkClean();
+		}
+
+		PendingRemovedIndices.Reset();
+		bPendingKeysChanged = false;
+		bReceivedReplication = true;
+	}
+
+	FORCEINLINE bool HasReceivedReplication() const
+	{
+		return bReceivedReplication;
 	}
 
 	
 public:
 	FORCEINLINE int32 GetIndex(const KeyType& Key) const
 	{
-		if (Map->Contains(Key))
-			return (*Map)[Key];
+		const int32* Index = Map->Find(Key);
+		if (Index)
+			return *Index;
 
 		return -1;
 	}
 
 	FORCEINLINE const KeyType* GetKey(int32 Index) const
 	{
-		return Map->FindKey(Index);
+		if (Array->IsValidIndex(Index))
+			return &(*Array)[Index].Key;
+
+		return nullptr;
 	}
 
 	
 	FORCEINLINE int32 Add(const KeyType Key, ValueType&& Item)
 	{
-		if (ContainsKey(Key))
-			return UpdateValue(Key, Item);
+		bool bAdded;
+		int32& Index = FindOrAddIndex(Key, bAdded);
+		if (!bAdded)
+			return UpdateValue(Index, Item);
 		
-		const int32 Index = Array->Add(PairType(Key, Item));
-		AddToMap(Key, Index);
+		Index = Array->Add(PairType(Key, MoveTemp(Item)));
+		IndexValue(Key, (*Array)[Index].Value);
 		return Index;
 	}
 
 	FORCEINLINE int32 Add(const KeyType Key, const ValueType& Item)
 	{
-		if (ContainsKey(Key))
-			return UpdateValue(Key, Item);
+		bool bAdded;
+		int32& Index = FindOrAddIndex(Key, bAdded);
+		if (!bAdded)
+			return UpdateValue(Index, Item);
 		
-		const int32 Index = Array->Add(PairType(Key, Item));
-		AddToMap(Key, Index);
+		Index = Array->Add(PairType(Key, Item));
+		IndexValue(Key, Item);
 		return Index;
 	}
 
 	FORCEINLINE int32 Emplace(const KeyType Key, ValueType Item)
 	{
-		if (ContainsKey(Key))
-			return UpdateValue(Key, Item);
+		bool bAdded;
+		int32& Index = FindOrAddIndex(Key, bAdded);
+		if (!bAdded)
+			return UpdateValue(Index, Item);
 		
-		const int32 Index = Array->Emplace(PairType(Key, Item));
-		AddToMap(Key, Index);
+		Index = Array->Emplace(Key, MoveTemp(Item));
+		IndexValue(Key, (*Array)[Index].Value);
 		return Index;
 	}
 
 	FORCEINLINE int32 EmplaceAt(const KeyType Key, ValueType Item, int32 Index)
 	{
-		// Todo Removal
-		
-		Array->EmplaceAt(Index, PairType(Key, Item));
-		AddToMap(Key, Index);
+		bool bAdded;
+		int32& MappedIndex = FindOrAddIndex(Key, bAdded);
+		if (!bAdded)
+			return UpdateValue(MappedIndex, Item);
 
-		IncrementMap(Index + 1);
+		// Shift the pairs currently at and after Index before the new pair takes its place.
+		IncrementMap(Index);
+		Array->EmplaceAt(Index, Key, MoveTemp(Item));
+		MappedIndex = Index;
+		IndexValue(Key, (*Array)[Index].Value);
 		
 		return Index;
 	}
@@ -178,24 +610,28 @@ public:
 
 	FORCEINLINE int32 Insert(const KeyType Key, const ValueType& Item, int32 Index)
 	{
-		if (ContainsKey(Key))
-			return UpdateValue(Key, Item);
-		
-		Index = Array->Insert(PairType(Key, Item), Index);
-		AddToMap(Key, Index);
+		bool bAdded;
+		int32& MappedIndex = FindOrAddIndex(Key, bAdded);
+		if (!bAdded)
+			return UpdateValue(MappedIndex, Item);
 
-		IncrementMap(Index + 1);
+		// Shift the pairs currently at and after Index before the new pair takes its place.
+		IncrementMap(Index);
+		MappedIndex = Array->Insert(PairType(Key, Item), Index);
+		IndexValue(Key, Item);
 		
-		return Index;
+		return MappedIndex;
 	}
 
 	FORCEINLINE bool Remove(const KeyType Key)
 	{
-		int32 Index = GetIndex(Key);
-		if (Array->IsValidIndex(Index))
+		int32 Index;
+		if (Map->RemoveAndCopyValue(Key, Index))
 		{
+			UnindexValue(Key);
 			Array->RemoveAt(Index);
-			RemoveFromMap(Key);
+			DecrementMap(Index + 1);
+			OnKeysChanged();
 			return true;
 		}
 
@@ -206,8 +642,33 @@ public:
 	{
 		if (Array->IsValidIndex(Index))
 		{
-			Array->RemoveAt(Index);
-			RemoveFromMap(Index);
+			RemoveAtFromMap(Index);
+			return true;
+		}
+
+		return false;
+	}
+
+	/** Unordered version of Remove. O(1) since only the last pair gets moved. */
+	FORCEINLINE bool RemoveSwap(const KeyType Key)
+	{
+		int32 Index;
+		if (Map->RemoveAndCopyValue(Key, Index))
+		{
+			UnindexValue(Key);
+			SwapLastInto(Index, Array->Num() - 1);
+			return true;
+		}
+
+		return false;
+	}
+
+	/** Unordered version of RemoveAt. O(1) since only the last pair gets moved. */
+	FORCEINLINE bool RemoveAtSwap(int32 Index)
+	{
+		if (Array->IsValidIndex(Index))
+		{
+			RemoveAtSwapFromMap(Index);
 			return true;
 		}
 
@@ -216,12 +677,12 @@ public:
 
 	FORCEINLINE PairType& operator[](KeyType Key)
 	{
-		return (*Array)[(*Map)[Key]];
+		return (*Array)[Map->FindChecked(Key)];
 	}
 
 	FORCEINLINE const PairType& operator[](KeyType Key) const
 	{
-		return (*Array)[(*Map)[Key]];
+		return (*Array)[Map->FindChecked(Key)];
 	}
 
 	FORCEINLINE PairType& operator[](int32 Index)
@@ -236,8 +697,9 @@ public:
 
 	FORCEINLINE PairType* GetPairAsPointer(KeyType Key)
 	{
-		if (ContainsKey(Key))
-			return &(*Array)[(*Map)[Key]];
+		const int32* Index = Map->Find(Key);
+		if (Index)
+			return &(*Array)[*Index];
 
 		return nullptr;
 	}
@@ -252,8 +714,9 @@ public:
 
 	FORCEINLINE const PairType* GetPairAsPointer(KeyType Key) const
 	{
-		if (ContainsKey(Key))
-			return &(*Array)[(*Map)[Key]];
+		const int32* Index = Map->Find(Key);
+		if (Index)
+			return &(*Array)[*Index];
 
 		return nullptr;
 	}
@@ -285,7 +748,151 @@ public:
 
 	FORCEINLINE void Empty(int32 AllocatedElements)
 	{
+		if (Array->Num() > 0)
+			OnKeysChanged();
+		
 		Array->Empty(AllocatedElements);
 		Map->Empty(AllocatedElements);
+		if (ValueIndex.IsValid())
+		{
+			ValueIndex->Reset(0);
+			ValueIndex->Shrink();
+		}
+	}
+
+	/** Same as Empty, but keeps every allocation for reuse. */
+	FORCEINLINE void Reset()
+	{
+		if (Array->Num() > 0)
+			OnKeysChanged();
+
+		Array->Reset();
+		Map->Reset();
+		if (ValueIndex.IsValid())
+			ValueIndex->Reset(0);
+	}
+
+	FORCEINLINE void Reserve(int32 Number)
+	{
+		Array->Reserve(Number);
+		Map->Reserve(Number);
+	}
+
+	/** Frees the slack of the pairs, the map and the value index. */
+	FORCEINLINE void Shrink()
+	{
+		Array->Shrink();
+		Map->Shrink();
+		OldKeys.Shrink();
+		PendingRemovedIndices.Shrink();
+		if (ValueIndex.IsValid())
+			ValueIndex->Shrink();
+	}
+
+	/** Bytes allocated by the pairs, the map and the value index, not counting the Keyed Array itself. */
+	FORCEINLINE SIZE_T GetAllocatedSize() const
+	{
+		return Array->GetAllocatedSize() + Map->GetAllocatedSize() + OldKeys.GetAllocatedSize()
+			+ PendingRemovedIndices.GetAllocatedSize() + (ValueIndex.IsValid() ? ValueIndex->GetAllocatedSize() : 0);
+	}
+
+	/** Bytes allocated for pairs that haven't been added yet. */
+	FORCEINLINE SIZE_T GetSlackSize() const
+	{
+		return Array->GetSlack() * sizeof(PairType);
+	}
+
+
+	/**
+	 * Adds every pair, or updates the value if the key already exists. Storage is reserved once up front.
+	 * OnPairWritten(int32 Index, bool bAdded) is called for every pair. Returns the number of keys added.
+	 */
+	template<typename CallbackType>
+	int32 Append(TArrayView<const PairType> Pairs, CallbackType&& OnPairWritten)
+	{
+		Reserve(Array->Num() + Pairs.Num());
+
+		int32 Additions = 0;
+		for (const PairType& Pair : Pairs)
+			if (AddOrUpdate(Pair.Key, Pair.Value, OnPairWritten))
+				Additions++;
+
+		return Additions;
+	}
+
+	/** Same as Append but with the keys and values in separate arrays of the same size. */
+	template<typename CallbackType>
+	int32 AddMany(TArrayView<const KeyType> Keys, TArrayView<const ValueType> Items, CallbackType&& OnPairWritten)
+	{
+		check(Keys.Num() == Items.Num());
+		Reserve(Array->Num() + Keys.Num());
+
+		int32 Additions = 0;
+		for (int32 i = 0; i < Keys.Num(); i++)
+			if (AddOrUpdate(Keys[i], Items[i], OnPairWritten))
+				Additions++;
+
+		return Additions;
+	}
+
+	/**
+	 * Removes the pairs of every given key with a single compaction of the array.
+	 * OnPairRemoved(const PairType&) is called for every pair before it is removed. Returns the number of removals.
+	 */
+	template<typename CallbackType>
+	int32 RemoveMany(TArrayView<const KeyType> Keys, CallbackType&& OnPairRemoved)
+	{
+		TBitArray<> RemovedFlags(false, Array->Num());
+		int32 FirstRemovedIndex = Array->Num();
+		int32 Removals = 0;
+		
+		for (const KeyType& Key : Keys)
+		{
+			int32 Index;
+			if (Map->RemoveAndCopyValue(Key, Index))
+			{
+				OnPairRemoved((*Array)[Index]);
+				UnindexValue(Key);
+				RemovedFlags[Index] = true;
+				FirstRemovedIndex = FMath::Min(FirstRemovedIndex, Index);
+				Removals++;
+			}
+		}
+
+		if (Removals > 0)
+			CompactRemoved(RemovedFlags, FirstRemovedIndex);
+
+		return Removals;
+	}
+
+	/**
+	 * Removes every pair the predicate returns true for with a single compaction of the array.
+	 * OnPairRemoved(const PairType&) is called for every pair before it is removed. Returns the number of removals.
+	 */
+	template<typename PredicateType, typename CallbackType>
+	int32 RemoveAllMatching(PredicateType Predicate, CallbackType&& OnPairRemoved)
+	{
+		TBitArray<> RemovedFlags(false, Array->Num());
+		int32 FirstRemovedIndex = Array->Num();
+		int32 Removals = 0;
+
+		for (int32 i = 0; i < Array->Num(); i++)
+		{
+			const PairType& Pair = (*Array)[i];
+			if (Predicate(Pair))
+			{
+				OnPairRemoved(Pair);
+				UnindexValue(Pair.Key);
+				Map->Remove(Pair.Key);
+				RemovedFlags[i] = true;
+				FirstRemovedIndex = FMath::Min(FirstRemovedIndex, i);
+				Removals++;
+			}
+		}
+
+		if (Removals > 0)
+			CompactRemoved(RemovedFlags, FirstRemovedIndex);
+
+		return Removals;
 	}
 };
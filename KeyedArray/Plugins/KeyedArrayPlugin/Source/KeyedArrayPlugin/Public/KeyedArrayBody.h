@@ -0,0 +1,817 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "InternalKeyedArray.h"
+#include "KeyedArrayKeyFuncs.h"
+#include "KeyedArrayDirectMap.h"
+#include "KeyedArraySmallMap.h"
+#include "KeyedArrayChangeSet.h"
+#include "KeyedArrayNetSerialization.h"
+#include "KeyedArrayReplicationChunks.h"
+#include "KeyedArrayReplicationConditions.h"
+#include "Net/Serialization/FastArraySerializer.h"
+
+/**
+ * Unreal doesn't allow generic USTRUCTs and the Unreal Header Tool doesn't expand macros, so a Keyed Array for a
+ * new Key/Value combination still needs its own USTRUCTs, library and component declared by hand.
+ * These macros provide everything that isn't reflected, so the only thing left to write is the reflected parts.
+ * Key hashing is picked at compile time by TKeyedArrayKeyFuncs, or replaced altogether by a direct lookup table
+ * through KEYED_ARRAY_BODY_WITH_MAP.
+ *
+ * A new Key/Value combination, here keyed by a UENUM EStat, needs the following (see NameFloatKeyedArray.h for a
+ * complete example including the library and component):
+ *
+ *	USTRUCT(BlueprintType)
+ *	struct FStatFloatPair : public FFastArraySerializerItem
+ *	{
+ *		GENERATED_BODY()
+ *
+ *		UPROPERTY(EditAnywhere, BlueprintReadWrite)
+ *		EStat Key;
+ *
+ *		UPROPERTY(EditAnywhere, BlueprintReadWrite)
+ *		float Value;
+ *
+ *		KEYED_ARRAY_PAIR_BODY(FStatFloatPair, EStat, float)
+ *	};
+ *
+ *	USTRUCT(BlueprintType)
+ *	struct FStatFloatKeyedArray : public FFastArraySerializer
+ *	{
+ *		GENERATED_BODY()
+ *
+ *		KEYED_ARRAY_BODY(FStatFloatKeyedArray, EStat, float, FStatFloatPair)
+ *
+ *	protected:
+ *		UPROPERTY(EditAnywhere)
+ *		TArray<FStatFloatPair> BackingPairs;
+ *
+ *		UPROPERTY(EditAnywhere, NotReplicated)
+ *		bool bSwapOnRemove;
+ *
+ *		UPROPERTY(Transient, NotReplicated)
+ *		uint32 KeyGeneration;
+ *	};
+ *
+ *	KEYED_ARRAY_TYPE_TRAITS(FStatFloatKeyedArray)
+ *
+ * Types containing commas (i.e. templates) have to be passed through a typedef.
+ * int32 can't be used as the key type since every index-based method would have the same signature as its
+ * key-based counterpart.
+ */
+
+/**
+ * Constructors of a pair. Key and Value have to be declared as UPROPERTYs by the pair itself.
+ * NetSerialize is only used, and only compiled, once enabled through KEYED_ARRAY_PAIR_TYPE_TRAITS.
+ */
+#define KEYED_ARRAY_PAIR_BODY(PairName, KeyTypeName, ValueTypeName) \
+public: \
+	PairName() \
+	{ \
+		Key = {}; \
+		Value = {}; \
+	} \
+	\
+	PairName(KeyTypeName NewKey, ValueTypeName NewValue) \
+	{ \
+		Key = NewKey; \
+		Value = NewValue; \
+	} \
+	\
+	template<typename ArchiveType> \
+	bool NetSerialize(ArchiveType& Ar, UPackageMap* Map, bool& bOutSuccess) \
+	{ \
+		const int64 StartBits = FKeyedArrayChunkScope::GetNumBitsWritten(); \
+		bOutSuccess = KeyedArrayNetSerializeKey(Ar, Map, Key); \
+		bOutSuccess &= KeyedArrayNetSerializeValue(Ar, Map, Key, Value); \
+		FKeyedArrayChunkScope::RecordPairBits(*this, StartBits); \
+		return true; \
+	}
+
+/**
+ * Replicates the pair through its NetSerialize, which sends FName keys listed in the UKeyedArrayKeyDictionary as a
+ * small index rather than a string. Every change then sends the whole pair, which for a key and a value is about the
+ * same as the per-property serialization it replaces.
+ */
+#define KEYED_ARRAY_PAIR_TYPE_TRAITS(PairName) \
+template<> \
+struct TStructOpsTypeTraits<PairName> : public TStructOpsTypeTraitsBase2<PairName> \
+{ \
+	enum \
+	{ \
+		WithNetSerializer = true, \
+	}; \
+};
+
+/**
+ * Every non-reflected member and method of a Keyed Array.
+ * BackingPairs, bSwapOnRemove and KeyGeneration have to be declared as UPROPERTYs by the Keyed Array itself:
+ * - BackingPairs is the replicated array of pairs.
+ * - bSwapOnRemove, when enabled, makes Remove and RemoveAt move the last pair into the removed slot instead of
+ *   shifting every pair after it. This makes removals O(1) but doesn't preserve the order of the pairs.
+ * - KeyGeneration is the structural version of the array, bumped when a key is added, removed or moved, and when
+ *   the pairs are loaded or swapped for pooled storage. It lets Clean skip checking every key when only values
+ *   have changed. It's a local counter, so it should be Transient and NotReplicated: clients bump their own from the
+ *   Fast Array callbacks.
+ * Leaves the access as public.
+ */
+#define KEYED_ARRAY_BODY(StructName, KeyTypeName, ValueTypeName, PairName) \
+	KEYED_ARRAY_BODY_WITH_MAP(StructName, KeyTypeName, ValueTypeName, PairName, TKeyedArrayMap<KeyTypeName>)
+
+/**
+ * Same as KEYED_ARRAY_BODY but with the key policy translating keys into indices given by MapTypeName, such as a
+ * TKeyedArrayDirectMap for small, dense integer or enum keys, or a TKeyedArraySmallMap for arrays that usually hold
+ * only a few keys. Since these usually contain a comma, pass a typedef.
+ */
+#define KEYED_ARRAY_BODY_WITH_MAP(StructName, KeyTypeName, ValueTypeName, PairName, MapTypeName) \
+public: \
+	static_assert(!TIsSame<KeyTypeName, int32>::Value, "int32 keys would clash with the index-based methods. Use an enum or another integer type instead."); \
+	\
+	typedef KeyTypeName KeyType; \
+	typedef ValueTypeName ValueType; \
+	typedef PairName PairType; \
+	typedef MapTypeName MapType; \
+	\
+protected: \
+	TInternalKeyedArray<KeyType, ValueType, PairType, MapType> Internal; \
+	\
+	MapType Translator; \
+	\
+	/** The keys touched by replication since ConsumeReplicatedChanges was last called. */ \
+	FKeyedArrayChangeSet ReplicatedChanges; \
+	\
+public: \
+	StructName() \
+	{ \
+		bSwapOnRemove = false; \
+		KeyGeneration = 0; \
+		Internal = TInternalKeyedArray<KeyType, ValueType, PairType, MapType>(&BackingPairs, &Translator, &KeyGeneration); \
+	} \
+	\
+	/** Copies have to point their Internal at their own storage rather than the original's. */ \
+	StructName(const StructName& Other) \
+		: FFastArraySerializer(Other) \
+	{ \
+		BackingPairs = Other.BackingPairs; \
+		Translator = Other.Translator; \
+		bSwapOnRemove = Other.bSwapOnRemove; \
+		KeyGeneration = Other.KeyGeneration; \
+		ReplicatedChanges = Other.ReplicatedChanges; \
+		CopyNetQuantization(Other); \
+		Internal = Other.Internal; \
+		Internal.Rebind(&BackingPairs, &Translator, &KeyGeneration); \
+	} \
+	\
+	StructName& operator=(const StructName& Other) \
+	{ \
+		if (this != &Other) \
+		{ \
+			FFastArraySerializer::operator=(Other); \
+			BackingPairs = Other.BackingPairs; \
+			Translator = Other.Translator; \
+			bSwapOnRemove = Other.bSwapOnRemove; \
+			KeyGeneration = Other.KeyGeneration; \
+			ReplicatedChanges = Other.ReplicatedChanges; \
+			CopyNetQuantization(Other); \
+			Internal = Other.Internal; \
+			Internal.Rebind(&BackingPairs, &Translator, &KeyGeneration); \
+		} \
+	\
+		return *this; \
+	} \
+	\
+public: \
+	/** \
+	 * Replicated changes keep the map up-to-date by themselves. Call this whenever the array was modified some \
+	 * other way (i.e. deserialized) to ensure the Map responsible for allowing key-based access is up-to-date. \
+	 * O(1) if the KeyGeneration hasn't changed since the map was last in sync. Loading and pooled storage bump it, \
+	 * but edits made to BackingPairs directly (i.e. in the details panel) and pairs replicated as a regular property \
+	 * (i.e. nested in another struct) don't, so Rebuild after those instead. \
+	 */ \
+	bool Clean() \
+	{ \
+		return Internal.Clean(); \
+	} \
+	\
+	/** \
+	 * Forcefully refreshes the map based entirely on the array data. This is expensive as it's O(n). \
+	 */ \
+	void Rebuild() \
+	{ \
+		Internal.Rebuild(); \
+	} \
+	\
+	/** Loaded pairs may come with any KeyGeneration, so the next Clean can't trust it. */ \
+	void PostSerialize(const FArchive& Ar) \
+	{ \
+		if (Ar.IsLoading()) \
+			Internal.OnStorageReplaced(); \
+	} \
+	\
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms) \
+	{ \
+		const FKeyedArrayNetQuantization::FScope QuantizationScope(GetNetQuantization<StructName>(0)); \
+		const FKeyedArrayReplicationConditions::FScope ConditionScope(DeltaParms); \
+		FKeyedArrayChunkScope ChunkScope(DeltaParms); \
+		if (ChunkScope.IsLimiting()) \
+			ChunkScope.SelectPairs(BackingPairs); \
+	\
+		if (ConditionScope.IsActive() || ChunkScope.IsLimiting()) \
+		{ \
+			/** The number of pairs to write is cached across connections, but now depends on the connection. */ \
+			CachedNumItems = INDEX_NONE; \
+			CachedNumItemsToConsiderForWriting = INDEX_NONE; \
+		} \
+	\
+		/** Pairs sending their keys through the key dictionary check it against the sender's first. */ \
+		if (TStructOpsTypeTraits<PairType>::WithNetSerializer && TIsSame<KeyType, FName>::Value \
+			&& !UKeyedArrayKeyDictionary::NetSerializeChecksum(DeltaParms)) \
+			return false; \
+	\
+		const bool bSerialized = ChunkScope.Finish( \
+			FFastArraySerializer::FastArrayDeltaSerialize<PairType, StructName>(BackingPairs, DeltaParms, *this)); \
+	\
+		/** The pairs to come are added chunk by chunk, so make room for them all at once. */ \
+		if (DeltaParms.Reader && ChunkScope.GetNumPairsToCome() > 0) \
+			Internal.Reserve(BackingPairs.Num() + ChunkScope.GetNumPairsToCome()); \
+	\
+		return bSerialized; \
+	} \
+	\
+	/** \
+	 * Leaves out the pairs the connection being written isn't meant to receive (see FKeyedArrayReplicationConditions) \
+	 * or that don't fit in this update (see FKeyedArrayChunkScope). \
+	 */ \
+	template<typename Type, typename SerializerType> \
+	FORCEINLINE bool ShouldWriteFastArrayItem(const Type& Item, const bool bIsWritingOnClient) \
+	{ \
+		return FFastArraySerializer::ShouldWriteFastArrayItem<Type, SerializerType>(Item, bIsWritingOnClient) \
+			&& FKeyedArrayReplicationConditions::ShouldReplicate(Item.Key) \
+			&& FKeyedArrayChunkScope::ShouldWrite(Item); \
+	} \
+	\
+	/** The NetQuantization UPROPERTY, if the Keyed Array declares one (see FKeyedArrayNetQuantization). */ \
+	template<typename SelfType> \
+	auto GetNetQuantization(int32) const -> decltype(&static_cast<const SelfType*>(this)->NetQuantization) \
+	{ \
+		return &static_cast<const SelfType*>(this)->NetQuantization; \
+	} \
+	\
+	template<typename SelfType> \
+	const FKeyedArrayNetQuantization* GetNetQuantization(...) const \
+	{ \
+		return nullptr; \
+	} \
+	\
+	void CopyNetQuantization(const StructName& Other) \
+	{ \
+		if (const FKeyedArrayNetQuantization* OtherQuantization = Other.GetNetQuantization<StructName>(0)) \
+			*const_cast<FKeyedArrayNetQuantization*>(GetNetQuantization<StructName>(0)) = *OtherQuantization; \
+	} \
+	\
+	void PreReplicatedRemove(const TArrayView<int32>& RemovedIndices, int32 FinalSize) \
+	{ \
+		for (const int32 Index : RemovedIndices) \
+			ReplicatedChanges.MarkRemoved(KeyedArrayKeyToName(BackingPairs[Index].Key)); \
+	\
+		Internal.PreReplicatedRemove(RemovedIndices); \
+	} \
+	\
+	void PostReplicatedAdd(const TArrayView<int32>& AddedIndices, int32 FinalSize) \
+	{ \
+		for (const int32 Index : AddedIndices) \
+			ReplicatedChanges.MarkAdded(KeyedArrayKeyToName(BackingPairs[Index].Key)); \
+	\
+		Internal.PostReplicatedAdd(AddedIndices); \
+	} \
+	\
+	void PostReplicatedChange(const TArrayView<int32>& ChangedIndices, int32 FinalSize) \
+	{ \
+		for (const int32 Index : ChangedIndices) \
+			ReplicatedChanges.MarkChanged(KeyedArrayKeyToName(BackingPairs[Index].Key)); \
+	\
+		Internal.PostReplicatedChange(ChangedIndices); \
+	} \
+	\
+	void PostReplicatedReceive(const FFastArraySerializer::FPostReplicatedReceiveParameters& Parameters) \
+	{ \
+		Internal.PostReplicatedReceive(); \
+	} \
+	\
+	/** Returns the keys touched by replication since the last call and starts collecting anew. */ \
+	FORCEINLINE FKeyedArrayChangeSet ConsumeReplicatedChanges() \
+	{ \
+		FKeyedArrayChangeSet ChangeSet = MoveTemp(ReplicatedChanges); \
+		ReplicatedChanges.Reset(); \
+		return ChangeSet; \
+	} \
+	\
+	FORCEINLINE void MarkIndexDirty(int32 Index) \
+	{ \
+		if (BackingPairs.IsValidIndex(Index)) \
+			MarkItemDirty(BackingPairs[Index]); \
+	} \
+	\
+	FORCEINLINE void MarkKeyDirty(KeyType Key) \
+	{ \
+		MarkIndexDirty(Internal.GetIndex(Key)); \
+	} \
+	\
+	\
+public: \
+	FORCEINLINE int32 Add(const KeyType Key, ValueType&& Item) \
+	{ \
+		const int32 Index = Internal.Add(Key, Item); \
+		MarkItemDirty(BackingPairs[Index]); \
+		return Index; \
+	} \
+	\
+	FORCEINLINE int32 Add(const KeyType Key, const ValueType& Item) \
+	{ \
+		const int32 Index = Internal.Add(Key, Item); \
+		MarkItemDirty(BackingPairs[Index]); \
+		return Index; \
+	} \
+	\
+	FORCEINLINE int32 Emplace(const KeyType Key, ValueType Item) \
+	{ \
+		const int32 Index = Internal.Emplace(Key, Item); \
+		MarkItemDirty(BackingPairs[Index]); \
+		return Index; \
+	} \
+	\
+	/** Server-only: clients remove replicated pairs by swapping the last one in, so their order differs. */ \
+	FORCEINLINE int32 EmplaceAt(const KeyType Key, ValueType Item, int32 Index) \
+	{ \
+		ensureMsgf(!Internal.HasReceivedReplication(), TEXT("Insert and EmplaceAt are server-only: the order of the pairs on clients doesn't match the server's.")); \
+		Index = Internal.EmplaceAt(Key, Item, Index); \
+		MarkItemDirty(BackingPairs[Index]); \
+		return Index; \
+	} \
+	\
+	\
+	/** Server-only, like EmplaceAt. */ \
+	FORCEINLINE int32 Insert(const KeyType Key, const ValueType& Item, int32 Index) \
+	{ \
+		ensureMsgf(!Internal.HasReceivedReplication(), TEXT("Insert and EmplaceAt are server-only: the order of the pairs on clients doesn't match the server's.")); \
+		Index = Internal.Insert(Key, Item, Index); \
+		MarkItemDirty(BackingPairs[Index]); \
+		return Index; \
+	} \
+	\
+	FORCEINLINE bool Remove(const KeyType Key) \
+	{ \
+		if (bSwapOnRemove) \
+			return RemoveSwap(Key); \
+	\
+		if (Internal.Remove(Key)) \
+		{ \
+			MarkArrayDirty(); \
+			return true; \
+		} \
+	\
+		return false; \
+	} \
+	\
+	FORCEINLINE bool RemoveSwap(const KeyType Key) \
+	{ \
+		if (Internal.RemoveSwap(Key)) \
+		{ \
+			MarkArrayDirty(); \
+			return true; \
+		} \
+	\
+		return false; \
+	} \
+	\
+	/** \
+	 * Adds every pair, or updates the value if the key already exists. Storage is only reserved once. \
+	 * Returns the number of keys added. OutChanges, if given, receives the keys that were added or changed. \
+	 */ \
+	int32 Append(TArrayView<const PairType> Pairs, FKeyedArrayChangeSet* OutChanges = nullptr) \
+	{ \
+		return Internal.Append(Pairs, [this, OutChanges](int32 Index, bool bAdded) \
+		{ \
+			OnPairWritten(Index, bAdded, OutChanges); \
+		}); \
+	} \
+	\
+	/** Same as Append but with the keys and values in separate arrays of the same size. */ \
+	int32 AddMany(TArrayView<const KeyType> Keys, TArrayView<const ValueType> Items, FKeyedArrayChangeSet* OutChanges = nullptr) \
+	{ \
+		return Internal.AddMany(Keys, Items, [this, OutChanges](int32 Index, bool bAdded) \
+		{ \
+			OnPairWritten(Index, bAdded, OutChanges); \
+		}); \
+	} \
+	\
+	/** \
+	 * Removes every given key with a single compaction of the array, preserving the order of the rest. \
+	 * Returns the number of keys removed. OutChanges, if given, receives the removed keys. \
+	 */ \
+	int32 RemoveMany(TArrayView<const KeyType> Keys, FKeyedArrayChangeSet* OutChanges = nullptr) \
+	{ \
+		const int32 Removals = Internal.RemoveMany(Keys, [OutChanges](const PairType& Pair) \
+		{ \
+			if (OutChanges) \
+				OutChanges->MarkRemoved(KeyedArrayKeyToName(Pair.Key)); \
+		}); \
+	\
+		if (Removals > 0) \
+			MarkArrayDirty(); \
+	\
+		return Removals; \
+	} \
+	\
+	/** \
+	 * Removes every pair the predicate returns true for with a single compaction of the array. \
+	 * Returns the number of pairs removed. OutChanges, if given, receives the removed keys. \
+	 */ \
+	template<typename PredicateType> \
+	int32 RemoveAllMatching(PredicateType Predicate, FKeyedArrayChangeSet* OutChanges = nullptr) \
+	{ \
+		const int32 Removals = Internal.RemoveAllMatching(Predicate, [OutChanges](const PairType& Pair) \
+		{ \
+			if (OutChanges) \
+				OutChanges->MarkRemoved(KeyedArrayKeyToName(Pair.Key)); \
+		}); \
+	\
+		if (Removals > 0) \
+			MarkArrayDirty(); \
+	\
+		return Removals; \
+	} \
+	\
+	/** Removes the first pair with the given value. Returns the index it was at, or -1 if there was none. */ \
+	FORCEINLINE int32 RemoveFirst(const ValueType& Item, FKeyedArrayChangeSet* OutChanges = nullptr) \
+	{ \
+		const int32 Index = GetFirstIndex(Item); \
+		if (Index > -1) \
+		{ \
+			if (OutChanges) \
+				OutChanges->MarkRemoved(KeyedArrayKeyToName(BackingPairs[Index].Key)); \
+	\
+			RemoveAt(Index); \
+		} \
+	\
+		return Index; \
+	} \
+	\
+	/** \
+	 * Removes every pair with the given value in a single pass, preserving the order of the rest. \
+	 * Returns the number of pairs removed. \
+	 */ \
+	FORCEINLINE int32 RemoveAll(const ValueType& Item, FKeyedArrayChangeSet* OutChanges = nullptr) \
+	{ \
+		return RemoveAllMatching([&Item](const PairType& Pair) \
+		{ \
+			return Pair.Value == Item; \
+		}, OutChanges); \
+	} \
+	\
+	FORCEINLINE bool RemoveAt(int32 Index) \
+	{ \
+		if (bSwapOnRemove) \
+			return RemoveAtSwap(Index); \
+	\
+		if (Internal.RemoveAt(Index)) \
+		{ \
+			MarkArrayDirty(); \
+			return true; \
+		} \
+	\
+		return false; \
+	} \
+	\
+	FORCEINLINE bool RemoveAtSwap(int32 Index) \
+	{ \
+		if (Internal.RemoveAtSwap(Index)) \
+		{ \
+			MarkArrayDirty(); \
+			return true; \
+		} \
+	\
+		return false; \
+	} \
+	\
+	\
+	FORCEINLINE PairType& GetPair(int32 Index) \
+	{ \
+		return Internal[Index]; \
+	} \
+	\
+	FORCEINLINE const PairType& GetPair(int32 Index) const \
+	{ \
+		return Internal[Index]; \
+	} \
+	\
+	FORCEINLINE PairType& GetPair(KeyType Key) \
+	{ \
+		return Internal[Key]; \
+	} \
+	\
+	FORCEINLINE const PairType& GetPair(KeyType Key) const \
+	{ \
+		return Internal[Key]; \
+	} \
+	\
+	/** \
+	 * Returns a copy so should only be used for small data types. \
+	 */ \
+	FORCEINLINE ValueType GetSafe(KeyType Key) const \
+	{ \
+		const ValueType* Value = GetAsPointer(Key); \
+		if (Value) \
+			return *Value; \
+	\
+		return ValueType(); \
+	} \
+	\
+	FORCEINLINE ValueType& operator[](KeyType Key) \
+	{ \
+		return GetPair(Key).Value; \
+	} \
+	\
+	FORCEINLINE const ValueType& operator[](KeyType Key) const \
+	{ \
+		return GetPair(Key).Value; \
+	} \
+	\
+	FORCEINLINE ValueType& operator[](int32 Index) \
+	{ \
+		return GetPair(Index).Value; \
+	} \
+	\
+	FORCEINLINE const ValueType& operator[](int32 Index) const \
+	{ \
+		return GetPair(Index).Value; \
+	} \
+	\
+	FORCEINLINE ValueType* GetAsPointer(KeyType Key) \
+	{ \
+		PairType* Pair = Internal.GetPairAsPointer(Key); \
+		if (Pair) \
+			return &Pair->Value; \
+	\
+		return nullptr; \
+	} \
+	\
+	FORCEINLINE ValueType* GetAsPointer(int32 Index) \
+	{ \
+		PairType* Pair = Internal.GetPairAsPointer(Index); \
+        if (Pair) \
+        	return &Pair->Value; \
+	\
+        return nullptr; \
+	} \
+	\
+	FORCEINLINE const ValueType* GetAsPointer(KeyType Key) const \
+	{ \
+		const PairType* Pair = Internal.GetPairAsPointer(Key); \
+		if (Pair) \
+			return &Pair->Value; \
+	\
+		return nullptr; \
+	} \
+	\
+	FORCEINLINE const ValueType* GetAsPointer(int32 Index) const \
+	{ \
+		const PairType* Pair = Internal.GetPairAsPointer(Index); \
+		if (Pair) \
+			return &Pair->Value; \
+	\
+		return nullptr; \
+	} \
+	\
+	FORCEINLINE int32 Num() const \
+	{ \
+		return BackingPairs.Num(); \
+	} \
+	\
+	FORCEINLINE bool Contains(KeyType Key) const \
+	{ \
+		return Translator.Contains(Key); \
+	} \
+	\
+	FORCEINLINE bool Contains(const ValueType& Item) const \
+	{ \
+		return GetFirstIndex(Item) > -1; \
+	} \
+	\
+	FORCEINLINE int32 GetFirstIndex(const ValueType& Item) const \
+	{ \
+		if (Internal.IsValueIndexEnabled()) \
+			return Internal.FindFirstIndexByValue(Item); \
+	\
+		for (int32 i = 0; i < BackingPairs.Num(); i++) \
+			if (BackingPairs[i].Value == Item) \
+				return i; \
+	\
+		return -1; \
+	} \
+	\
+	FORCEINLINE KeyType GetFirstKey(const ValueType& Item) const \
+	{ \
+		const KeyType* FirstKey = FindFirstKey(Item); \
+		if (FirstKey) \
+			return *FirstKey; \
+	\
+		return KeyType(); \
+	} \
+	\
+	FORCEINLINE const KeyType* FindFirstKey(const ValueType& Item) const \
+	{ \
+		return Internal.GetKey(GetFirstIndex(Item)); \
+	} \
+	\
+	FORCEINLINE const KeyType* GetKey(int32 Index) const \
+	{ \
+		return Internal.GetKey(Index); \
+	} \
+	\
+	FORCEINLINE KeyType GetKey(int32 Index) \
+	{ \
+		const KeyType* Key = Internal.GetKey(Index); \
+		if (Key) \
+			return *Key; \
+	\
+		return KeyType(); \
+	} \
+	\
+	FORCEINLINE bool IsValidIndex(int32 Index) const \
+	{ \
+		return BackingPairs.IsValidIndex(Index); \
+	} \
+	\
+	FORCEINLINE ValueType& Last(int32 IndexFromTheEnd = 0) \
+	{ \
+		return LastPair(IndexFromTheEnd).Value; \
+	} \
+	\
+	FORCEINLINE const ValueType& Last(int32 IndexFromTheEnd = 0) const \
+	{ \
+		return LastPair(IndexFromTheEnd).Value; \
+	} \
+	\
+	FORCEINLINE PairType& LastPair(int32 IndexFromTheEnd = 0) \
+	{ \
+		return Internal.Last(IndexFromTheEnd); \
+	} \
+	\
+	FORCEINLINE const PairType& LastPair(int32 IndexFromTheEnd = 0) const \
+	{ \
+		return Internal.Last(IndexFromTheEnd); \
+	} \
+	\
+	FORCEINLINE void Empty(int32 AllocatedElements = 0) \
+	{ \
+		Internal.Empty(AllocatedElements); \
+		MarkArrayDirty(); \
+	} \
+	\
+	FORCEINLINE void Reserve(int32 Number) \
+	{ \
+		Internal.Reserve(Number); \
+	} \
+	\
+	/** Frees the memory reserved for pairs that haven't been added, along with the slack of the map. */ \
+	FORCEINLINE void Shrink() \
+	{ \
+		Internal.Shrink(); \
+	} \
+	\
+	/** Bytes allocated by the pairs, the map and the value index, not counting the struct itself. */ \
+	FORCEINLINE SIZE_T GetAllocatedSize() const \
+	{ \
+		return Internal.GetAllocatedSize(); \
+	} \
+	\
+	/** Bytes allocated for pairs that haven't been added yet. */ \
+	FORCEINLINE SIZE_T GetSlackSize() const \
+	{ \
+		return Internal.GetSlackSize(); \
+	} \
+	\
+	/** \
+	 * Empties the Keyed Array and moves the allocations of its pairs and map into OutStorage (i.e. a \
+	 * TKeyedArrayPooledStorage), which must have a Pairs array and a Map of the same types. \
+	 */ \
+	template<typename StorageType> \
+	void ReleaseStorage(StorageType& OutStorage) \
+	{ \
+		Internal.Reset(); \
+		OutStorage.Pairs = MoveTemp(BackingPairs); \
+		OutStorage.Map = MoveTemp(Translator); \
+		Internal.Rebind(&BackingPairs, &Translator, &KeyGeneration); \
+		Internal.OnStorageReplaced(); \
+		MarkArrayDirty(); \
+	} \
+	\
+	/** Takes the allocations released by another Keyed Array of the same type. Only valid while empty. */ \
+	template<typename StorageType> \
+	void AdoptStorage(StorageType& Storage) \
+	{ \
+		check(BackingPairs.Num() == 0 && Storage.Pairs.Num() == 0); \
+		BackingPairs = MoveTemp(Storage.Pairs); \
+		Translator = MoveTemp(Storage.Map); \
+		Internal.Rebind(&BackingPairs, &Translator, &KeyGeneration); \
+		Internal.OnStorageReplaced(); \
+	} \
+	\
+	/** \
+	 * Keeps a map of values to keys so finding pairs by value (GetFirstIndex, FindFirstKey, RemoveFirst, etc.) \
+	 * is O(1) rather than a scan of the array, at the cost of extra memory and work on every modification. \
+	 * This is local to this instance; it isn't serialized nor replicated, so clients have to enable it themselves. \
+	 * The index is only allocated while enabled, and the values only need GetTypeHash if it ever is. \
+	 */ \
+	template<typename ValueIndexType = TKeyedArrayValueIndex<KeyType, ValueType>> \
+	FORCEINLINE void SetValueIndexEnabled(bool bEnabled) \
+	{ \
+		Internal.template SetValueIndexEnabled<ValueIndexType>(bEnabled); \
+	} \
+	\
+	FORCEINLINE bool IsValueIndexEnabled() const \
+	{ \
+		return Internal.IsValueIndexEnabled(); \
+	} \
+	\
+	/** Only needed if values were modified without going through the Keyed Array (i.e. edited in place). */ \
+	FORCEINLINE void RebuildValueIndex() \
+	{ \
+		Internal.RebuildValueIndex(); \
+	} \
+	\
+	FORCEINLINE bool IsSwapOnRemove() const \
+	{ \
+		return bSwapOnRemove; \
+	} \
+	\
+	FORCEINLINE void SetSwapOnRemove(bool bNewSwapOnRemove) \
+	{ \
+		bSwapOnRemove = bNewSwapOnRemove; \
+	} \
+	\
+	FORCEINLINE const TArray<PairType>& GetData() const \
+	{ \
+		return BackingPairs; \
+	} \
+	\
+	FORCEINLINE const MapType& GetTranslator() const \
+	{ \
+		return Translator; \
+	} \
+	\
+	/** Copies the translator into a regular TMap, whatever the key policy is. */ \
+	TMap<KeyType, int32> GetTranslatorAsMap() const \
+	{ \
+		TMap<KeyType, int32> Map; \
+		Map.Reserve(BackingPairs.Num()); \
+		for (int32 i = 0; i < BackingPairs.Num(); i++) \
+			Map.Add(BackingPairs[i].Key, i); \
+		\
+		return Map; \
+	} \
+	\
+	FORCEINLINE const TInternalKeyedArray<KeyType, ValueType, PairType, MapType>& GetInternal() const \
+	{ \
+		return Internal; \
+	} \
+	\
+	FORCEINLINE uint32 GetKeyGeneration() const \
+	{ \
+		return KeyGeneration; \
+	} \
+	\
+protected: \
+	FORCEINLINE void OnPairWritten(int32 Index, bool bAdded, FKeyedArrayChangeSet* OutChanges) \
+	{ \
+		MarkItemDirty(BackingPairs[Index]); \
+		if (OutChanges) \
+		{ \
+			if (bAdded) \
+				OutChanges->MarkAdded(KeyedArrayKeyToName(BackingPairs[Index].Key)); \
+			else \
+				OutChanges->MarkChanged(KeyedArrayKeyToName(BackingPairs[Index].Key)); \
+		} \
+	} \
+	\
+public:
+
+/**
+ * Has to follow every Keyed Array so it gets delta replicated as a Fast Array, and its KeyGeneration bumped after
+ * loading.
+ *
+ * Only the legacy replication path is supported, which is why the module doesn't opt into Iris: there is no Iris
+ * FNetSerializer, and key conditions, chunked sending, the key dictionary and value quantization all hook into
+ * NetDeltaSerialize, ShouldWriteFastArrayItem and the pair NetSerialize, none of which Iris calls.
+ */
+#define KEYED_ARRAY_TYPE_TRAITS(StructName) \
+template<> \
+struct TStructOpsTypeTraits<StructName> : public TStructOpsTypeTraitsBase2<StructName> \
+{ \
+	enum \
+	{ \
+		WithNetDeltaSerializer = true, \
+		WithPostSerialize = true, \
+	}; \
+};
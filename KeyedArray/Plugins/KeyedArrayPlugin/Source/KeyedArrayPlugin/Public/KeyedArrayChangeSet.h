@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "Templates/IsEnum.h"
+#include "KeyedArrayChangeSet.generated.h"
+
+
+UENUM(BlueprintType)
+enum class EKeyedArrayChangeType : uint8
+{
+	Added,
+	Removed,
+	Changed
+};
+
+/**
+ * The keys that were added, removed or had their value changed by one or more modifications of a Keyed Array.
+ * Lets listeners react to exactly what changed instead of scanning the whole array.
+ */
+USTRUCT(BlueprintType)
+struct FKeyedArrayChangeSet
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly)
+	TSet<FName> Added;
+
+	UPROPERTY(BlueprintReadOnly)
+	TSet<FName> Removed;
+
+	UPROPERTY(BlueprintReadOnly)
+	TSet<FName> Changed;
+
+public:
+	FORCEINLINE void MarkAdded(const FName Key)
+	{
+		// Removed then added again is, as far as listeners are concerned, just a new value.
+		if (Removed.Remove(Key) > 0)
+			Changed.Add(Key);
+		else
+			Added.Add(Key);
+	}
+
+	FORCEINLINE void MarkRemoved(const FName Key)
+	{
+		// Listeners never got to see the key if it was only just added.
+		if (Added.Remove(Key) > 0)
+			return;
+
+		Changed.Remove(Key);
+		Removed.Add(Key);
+	}
+
+	FORCEINLINE void MarkChanged(const FName Key)
+	{
+		// A key that was only just added is still new to listeners.
+		if (!Added.Contains(Key))
+			Changed.Add(Key);
+	}
+
+	/** Merges a later change set into this one. */
+	FORCEINLINE void Append(const FKeyedArrayChangeSet& Other)
+	{
+		for (const FName& Key : Other.Removed)
+			MarkRemoved(Key);
+
+		for (const FName& Key : Other.Added)
+			MarkAdded(Key);
+
+		for (const FName& Key : Other.Changed)
+			MarkChanged(Key);
+	}
+
+	FORCEINLINE bool IsEmpty() const
+	{
+		return Added.Num() == 0 && Removed.Num() == 0 && Changed.Num() == 0;
+	}
+
+	FORCEINLINE void Reset()
+	{
+		Added.Reset();
+		Removed.Reset();
+		Changed.Reset();
+	}
+};
+
+/**
+ * Looking a converted key up in the name table is slow enough to matter when it's done for every pair sent or
+ * received, so the names of other key types are cached per thread. The cache is emptied whenever it fills up, so
+ * keys from a huge range (i.e. hashes) don't grow it without bound.
+ */
+template<typename KeyType, typename ToNameType>
+FORCEINLINE FName KeyedArrayCachedKeyName(const KeyType& Key, ToNameType ToName)
+{
+	static thread_local TMap<KeyType, FName> Names;
+	if (const FName* Found = Names.Find(Key))
+		return *Found;
+
+	if (Names.Num() >= 4096)
+		Names.Reset();
+
+	return Names.Add(Key, ToName(Key));
+}
+
+/**
+ * Change sets record keys as FNames so they can be used from Blueprints. Keyed Arrays with other key types convert
+ * their keys through these, so give a key type that LexToString doesn't support (i.e. FGameplayTag) its own
+ * overload, declared before the Keyed Array.
+ */
+FORCEINLINE FName KeyedArrayKeyToName(const FName Key)
+{
+	return Key;
+}
+
+template<typename KeyType>
+FORCEINLINE typename TEnableIf<TIsEnum<KeyType>::Value, FName>::Type KeyedArrayKeyToName(const KeyType Key)
+{
+	return KeyedArrayCachedKeyName(Key, [](const KeyType InKey) { return FName(*LexToString(static_cast<int64>(InKey))); });
+}
+
+template<typename KeyType>
+FORCEINLINE typename TEnableIf<!TIsEnum<KeyType>::Value, FName>::Type KeyedArrayKeyToName(const KeyType& Key)
+{
+	return KeyedArrayCachedKeyName(Key, [](const KeyType& InKey) { return FName(*LexToString(InKey)); });
+}
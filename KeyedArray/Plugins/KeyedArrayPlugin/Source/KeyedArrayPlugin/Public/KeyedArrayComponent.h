@@ -0,0 +1,208 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "Components/ActorComponent.h"
+#include "KeyedArrayChangeSet.h"
+#include "KeyedArrayReplicationConditions.h"
+#include "KeyedArrayComponent.generated.h"
+
+
+class UKeyedArrayStoragePool;
+class UNetConnection;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FKeyedArrayChangeSetSignature,
+	const FKeyedArrayChangeSet&, ChangeSet);
+
+DECLARE_DYNAMIC_DELEGATE_TwoParams(FKeyedArrayKeyChangedSignature,
+	FName, Key, EKeyedArrayChangeType, ChangeType);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FKeyedArrayFullySyncedSignature);
+
+/**
+ *  The functionality shared by every Keyed Array component that doesn't depend on the Key/Value types.
+ *  Turns change sets into notifications, both for the whole change set and for listeners of individual keys.
+ */
+UCLASS(Abstract)
+class UKeyedArrayComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Broadcast with the keys that were added, removed or changed by each modification. */
+	UPROPERTY(BlueprintCallable, BlueprintAssignable)
+	FKeyedArrayChangeSetSignature OnKeyedArrayKeysChanged;
+
+	/**
+	 * Broadcast on clients once they have received every pair the server has for them, after the first update and
+	 * again after every update that was split across several (see MaxBytesPerUpdate).
+	 */
+	UPROPERTY(BlueprintCallable, BlueprintAssignable)
+	FKeyedArrayFullySyncedSignature OnKeyedArrayFullySynced;
+
+	/**
+	 * When above zero, the pairs a connection doesn't have yet are sent a few at a time, spending about this many bytes
+	 * per update, instead of all at once. Changes to pairs the connection already has are sent straight away.
+	 * Only the server's setting matters; clients are told how many pairs are still to come either way.
+	 */
+	UPROPERTY(EditAnywhere, meta = (ClampMin = 0))
+	int32 MaxBytesPerUpdate = 0;
+
+	/** When sending the pairs a few at a time, those with the highest priority go first. Keys default to 0. */
+	UPROPERTY(EditAnywhere)
+	TMap<FName, int32> KeyPriorities;
+
+	/**
+	 * Takes the Keyed Array's storage from the world's UKeyedArrayStoragePool when registered and gives it back when
+	 * destroyed, so actors that are spawned and destroyed in large numbers keep reusing the same allocations.
+	 */
+	UPROPERTY(EditAnywhere)
+	bool bUseStoragePool = false;
+
+	/** Calls the delegate whenever the given key is added, removed or has its value changed. */
+	UFUNCTION(BlueprintCallable)
+	void BindToKey(const FName Key, FKeyedArrayKeyChangedSignature Delegate);
+
+	UFUNCTION(BlueprintCallable)
+	void UnbindFromKey(const FName Key, FKeyedArrayKeyChangedSignature Delegate);
+
+	UFUNCTION(BlueprintCallable)
+	void UnbindAllFromKey(const FName Key);
+
+	/**
+	 * Until the matching EndBatch, modifications are neither marked dirty nor broadcast individually.
+	 * Instead, EndBatch marks the Keyed Array dirty once and sends a single notification with the merged change
+	 * set. Batches can be nested; only the outermost EndBatch notifies.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void BeginBatch();
+
+	UFUNCTION(BlueprintCallable)
+	void EndBatch();
+
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool IsBatching() const;
+
+	/** Bytes allocated by the Keyed Array, not counting the component itself. */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	int64 GetAllocatedSize() const;
+
+	/** Bytes allocated for pairs that haven't been added yet. Reclaim it with Shrink. */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	int64 GetSlackSize() const;
+
+	/** Whether every pair has been received from the server. Always true on the server. */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	bool IsFullySynced() const;
+
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	const FKeyedArrayReplicationConditions& GetKeyConditions() const;
+
+	/** Changes which connections the key is replicated to. Only the server's conditions matter. */
+	UFUNCTION(BlueprintCallable)
+	void SetKeyCondition(const FName Key, EKeyedArrayKeyCondition Condition);
+
+	/** Changes which connections the keys without a condition of their own are replicated to. */
+	UFUNCTION(BlueprintCallable)
+	void SetDefaultKeyCondition(EKeyedArrayKeyCondition Condition);
+
+	/**
+	 * Conditions are only evaluated again once the Keyed Array changes. Call this when what they depend on changes
+	 * instead, i.e. the owner of the actor or what ShouldReplicateKey returns.
+	 */
+	UFUNCTION(BlueprintCallable)
+	void RefreshKeyConditions();
+
+	/** Whether a key with the Custom condition is replicated to the connection. Sent to every connection by default. */
+	virtual bool ShouldReplicateKey(const FName Key, const UNetConnection* Connection, bool bIsOwner) const;
+
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	virtual void OnRegister() override;
+
+	virtual void OnComponentDestroyed(bool bDestroyingHierarchy) override;
+
+protected:
+	/**
+	 * Which connections each key is replicated to, i.e. only to the owner for hidden stats and cooldowns.
+	 * Only applies to the Keyed Array replicated as a property of this component. A Keyed Array replicated by anything
+	 * else, i.e. an actor, is sent whole to every connection.
+	 */
+	UPROPERTY(EditAnywhere)
+	FKeyedArrayReplicationConditions KeyConditions;
+
+	/** Call after every modification. Notifies straight away unless a batch is open. */
+	void SubmitChanges(const FKeyedArrayChangeSet& ChangeSet);
+
+	/** Marks the Keyed Array dirty and broadcasts the changes. */
+	virtual void FlushChanges(const FKeyedArrayChangeSet& ChangeSet) PURE_VIRTUAL(UKeyedArrayComponent::FlushChanges, );
+
+	/** Marks the whole Keyed Array dirty so every pair is considered for replication again. */
+	virtual void MarkKeyedArrayDirty() PURE_VIRTUAL(UKeyedArrayComponent::MarkKeyedArrayDirty, );
+
+	/** Marks the Keyed Array property dirty for push model replication, without touching the pairs. */
+	virtual void MarkKeyedArrayPropertyDirty() PURE_VIRTUAL(UKeyedArrayComponent::MarkKeyedArrayPropertyDirty, );
+
+	virtual SIZE_T GetKeyedArrayAllocatedSize() const PURE_VIRTUAL(UKeyedArrayComponent::GetKeyedArrayAllocatedSize, return 0;);
+
+	virtual SIZE_T GetKeyedArraySlackSize() const PURE_VIRTUAL(UKeyedArrayComponent::GetKeyedArraySlackSize, return 0;);
+
+	virtual void AcquireStorage(UKeyedArrayStoragePool& Pool) PURE_VIRTUAL(UKeyedArrayComponent::AcquireStorage, );
+
+	virtual void ReleaseStorage(UKeyedArrayStoragePool& Pool) PURE_VIRTUAL(UKeyedArrayComponent::ReleaseStorage, );
+	
+	void NotifyKeysChanged(const FKeyedArrayChangeSet& ChangeSet);
+
+	/** Call after every replicated update. Broadcasts OnKeyedArrayFullySynced once no pairs are left to come. */
+	void NotifyIfFullySynced();
+
+private:
+	friend class FKeyedArrayChunkScope;
+
+	/** Makes sure the Keyed Array is replicated again next frame, so the next pairs get sent. */
+	void ScheduleNextChunk();
+
+	void ReceivePairsToCome(int32 NumPairs);
+
+	void NotifyKey(const FName Key, EKeyedArrayChangeType ChangeType);
+	
+	TMap<FName, TArray<FKeyedArrayKeyChangedSignature>> KeyBindings;
+
+	int32 BatchDepth = 0;
+
+	/** Components can be registered more than once, but should only ask the pool for storage the first time. */
+	bool bStorageAcquired = false;
+	FKeyedArrayChangeSet BatchedChanges;
+
+	/** Learned from the updates sent so far, to know how many pairs fit in MaxBytesPerUpdate. */
+	float BytesPerPairEstimate = 0.f;
+
+	bool bNextChunkScheduled = false;
+	int32 NumPairsToCome = 0;
+	bool bFullySynced = false;
+};
+
+/**
+ *  Batches every modification made to a Keyed Array component for as long as the scope lives.
+ *  i.e. applying a whole loadout inside a scope results in a single dirty-mark and broadcast.
+ */
+struct FKeyedArrayBatchScope
+{
+	explicit FKeyedArrayBatchScope(UKeyedArrayComponent* NewComponent)
+	{
+		Component = NewComponent;
+		if (Component)
+			Component->BeginBatch();
+	}
+
+	~FKeyedArrayBatchScope()
+	{
+		if (Component)
+			Component->EndBatch();
+	}
+
+	FKeyedArrayBatchScope(const FKeyedArrayBatchScope&) = delete;
+	FKeyedArrayBatchScope& operator=(const FKeyedArrayBatchScope&) = delete;
+
+private:
+	UKeyedArrayComponent* Component;
+};
@@ -0,0 +1,283 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "KeyedArrayKeyFuncs.h"
+
+/**
+ * Replaces the TMap of a Keyed Array whose keys are small, dense integers or enums (i.e. ability slots or stat IDs).
+ * The index of every key is stored in a flat table indexed by the key itself, so a lookup is a single array load
+ * without any hashing, and emptying it (i.e. in Rebuild) is a single memset.
+ *
+ * The key range is either set at compile time through NumKeys, or at run time, in which case the table grows to fit
+ * the keys added as long as they stay dense. SetKeyRange allocates it up front.
+ * Keys outside of the range (negative, past NumKeys, or too far past the table to grow it) still work but go into a
+ * regular map, losing the direct lookup. Memory is proportional to the largest key in the table rather than the number
+ * of pairs, so sparse keys should use a TMap.
+ *
+ * Only the subset of the TMap interface used by TInternalKeyedArray is implemented.
+ */
+template<typename KeyType, int32 NumKeys = 0>
+class TKeyedArrayDirectMap
+{
+	typedef TKeyedArrayMap<KeyType> OverflowMapType;
+
+	/** Index of the pair with the key at that slot, or INDEX_NONE. */
+	TArray<int32> Table;
+
+	/** Keys outside of the table. */
+	OverflowMapType Overflow;
+
+	int32 NumPairs;
+
+public:
+	/** What iterating yields, mirroring the Key and Value of a TMap's pairs. */
+	template<typename IndexType>
+	struct TEntry
+	{
+		KeyType Key;
+		IndexType& Value;
+	};
+
+	/** Goes through the table, then through the overflow. */
+	template<typename TableType, typename OverflowIteratorType, typename IndexType>
+	class TBaseIterator
+	{
+		TableType& Table;
+		OverflowIteratorType OverflowIt;
+		int32 Slot;
+
+	public:
+		TBaseIterator(TableType& InTable, OverflowIteratorType InOverflowIt, int32 StartSlot)
+			: Table(InTable)
+			, OverflowIt(InOverflowIt)
+		{
+			Slot = StartSlot;
+			SkipEmptySlots();
+		}
+
+		FORCEINLINE TEntry<IndexType> operator*() const
+		{
+			if (Slot >= Table.Num())
+				return TEntry<IndexType>{ OverflowIt.Key(), OverflowIt.Value() };
+
+			return TEntry<IndexType>{ static_cast<KeyType>(Slot), Table[Slot] };
+		}
+
+		FORCEINLINE TBaseIterator& operator++()
+		{
+			if (Slot >= Table.Num())
+			{
+				++OverflowIt;
+				return *this;
+			}
+
+			Slot++;
+			SkipEmptySlots();
+			return *this;
+		}
+
+		/** Only meant for comparing against end(). */
+		FORCEINLINE bool operator!=(const TBaseIterator& Other) const
+		{
+			return Slot != Other.Slot || static_cast<bool>(OverflowIt);
+		}
+
+	private:
+		FORCEINLINE void SkipEmptySlots()
+		{
+			while (Slot < Table.Num() && Table[Slot] == INDEX_NONE)
+				Slot++;
+		}
+	};
+
+	typedef TBaseIterator<TArray<int32>, typename OverflowMapType::TIterator, int32> TIterator;
+	typedef TBaseIterator<const TArray<int32>, typename OverflowMapType::TConstIterator, const int32> TConstIterator;
+
+	TKeyedArrayDirectMap()
+	{
+		NumPairs = 0;
+		if (NumKeys > 0)
+			Table.Init(INDEX_NONE, NumKeys);
+	}
+
+	/** Makes room for every key below NewNumKeys. Only needed if the key range wasn't set at compile time. */
+	void SetKeyRange(int32 NewNumKeys)
+	{
+		checkf(NumKeys == 0 || NewNumKeys <= NumKeys, TEXT("The key range was set to %d at compile time."), NumKeys);
+		if (NewNumKeys > Table.Num())
+		{
+			const int32 OldNumKeys = Table.Num();
+			Table.SetNumUninitialized(NewNumKeys);
+			FMemory::Memset(Table.GetData() + OldNumKeys, 0xFF, (NewNumKeys - OldNumKeys) * sizeof(int32));
+
+			// Overflowed keys now within the range have to move into the table, where Find looks for them.
+			for (typename OverflowMapType::TIterator It = Overflow.CreateIterator(); It; ++It)
+			{
+				const int32 Slot = ToSlot(It.Key());
+				if (Table.IsValidIndex(Slot))
+				{
+					Table[Slot] = It.Value();
+					It.RemoveCurrent();
+				}
+			}
+		}
+	}
+
+	FORCEINLINE int32 GetKeyRange() const
+	{
+		return Table.Num();
+	}
+
+	FORCEINLINE int32 Num() const
+	{
+		return NumPairs;
+	}
+
+	FORCEINLINE int32* Find(KeyType Key)
+	{
+		const int32 Slot = ToSlot(Key);
+		if (Table.IsValidIndex(Slot))
+			return Table[Slot] != INDEX_NONE ? &Table[Slot] : nullptr;
+
+		return Overflow.Num() > 0 ? Overflow.Find(Key) : nullptr;
+	}
+
+	FORCEINLINE const int32* Find(KeyType Key) const
+	{
+		const int32 Slot = ToSlot(Key);
+		if (Table.IsValidIndex(Slot))
+			return Table[Slot] != INDEX_NONE ? &Table[Slot] : nullptr;
+
+		return Overflow.Num() > 0 ? Overflow.Find(Key) : nullptr;
+	}
+
+	FORCEINLINE int32& FindChecked(KeyType Key)
+	{
+		int32* Index = Find(Key);
+		check(Index);
+		return *Index;
+	}
+
+	FORCEINLINE const int32& FindChecked(KeyType Key) const
+	{
+		const int32* Index = Find(Key);
+		check(Index);
+		return *Index;
+	}
+
+	FORCEINLINE bool Contains(KeyType Key) const
+	{
+		return Find(Key) != nullptr;
+	}
+
+	/** Like TMap, a new key starts with an index of 0 which the caller is expected to overwrite. */
+	FORCEINLINE int32& FindOrAdd(KeyType Key)
+	{
+		const int32 Slot = ToSlot(Key);
+
+		// Without a compile time range, the table only grows to fit keys below 256 or twice its size, so a single
+		// large key can't allocate a slot for every key below it.
+		if (NumKeys == 0 && Slot >= Table.Num() && Slot < FMath::Max(Table.Num() * 2, 256))
+			SetKeyRange(FMath::Max(Slot + 1, Table.Num() * 2));
+
+		if (!Table.IsValidIndex(Slot))
+		{
+			const int32 NumBefore = Overflow.Num();
+			int32& Index = Overflow.FindOrAdd(Key);
+			NumPairs += Overflow.Num() - NumBefore;
+			return Index;
+		}
+
+		int32& Index = Table[Slot];
+		if (Index == INDEX_NONE)
+		{
+			Index = 0;
+			NumPairs++;
+		}
+
+		return Index;
+	}
+
+	FORCEINLINE int32& Add(KeyType Key, int32 Index)
+	{
+		int32& MappedIndex = FindOrAdd(Key);
+		MappedIndex = Index;
+		return MappedIndex;
+	}
+
+	FORCEINLINE int32 Remove(KeyType Key)
+	{
+		int32 Index;
+		return RemoveAndCopyValue(Key, Index) ? 1 : 0;
+	}
+
+	FORCEINLINE bool RemoveAndCopyValue(KeyType Key, int32& OutIndex)
+	{
+		const int32 Slot = ToSlot(Key);
+		if (!Table.IsValidIndex(Slot))
+		{
+			if (!Overflow.RemoveAndCopyValue(Key, OutIndex))
+				return false;
+
+			NumPairs--;
+			return true;
+		}
+
+		int32& Index = Table[Slot];
+		if (Index == INDEX_NONE)
+			return false;
+
+		OutIndex = Index;
+		Index = INDEX_NONE;
+		NumPairs--;
+		return true;
+	}
+
+	/** Forgets every key but keeps the key range, so it's just a memset. */
+	FORCEINLINE void Empty(int32 ExpectedNumElements = 0)
+	{
+		if (Table.Num() > 0)
+			FMemory::Memset(Table.GetData(), 0xFF, Table.Num() * sizeof(int32));
+
+		Overflow.Reset();
+		NumPairs = 0;
+	}
+
+	FORCEINLINE void Reset()
+	{
+		Empty();
+	}
+
+	/** The table is sized by the key range rather than the number of pairs, so there's nothing to reserve. */
+	FORCEINLINE void Reserve(int32 Number)
+	{
+	}
+
+	/** Likewise, the table always covers the whole key range. Only the overflow has slack. */
+	FORCEINLINE void Shrink()
+	{
+		Overflow.Shrink();
+	}
+
+	FORCEINLINE SIZE_T GetAllocatedSize() const
+	{
+		return Table.GetAllocatedSize() + Overflow.GetAllocatedSize();
+	}
+
+	/** Whether any key is outside of the key range, and looked up through a regular map. */
+	FORCEINLINE bool HasOverflow() const
+	{
+		return Overflow.Num() > 0;
+	}
+
+	FORCEINLINE TIterator begin() { return TIterator(Table, Overflow.CreateIterator(), 0); }
+	FORCEINLINE TConstIterator begin() const { return TConstIterator(Table, Overflow.CreateConstIterator(), 0); }
+	FORCEINLINE TIterator end() { return TIterator(Table, Overflow.CreateIterator(), Table.Num()); }
+	FORCEINLINE TConstIterator end() const { return TConstIterator(Table, Overflow.CreateConstIterator(), Table.Num()); }
+
+private:
+	static FORCEINLINE int32 ToSlot(KeyType Key)
+	{
+		return static_cast<int32>(Key);
+	}
+};
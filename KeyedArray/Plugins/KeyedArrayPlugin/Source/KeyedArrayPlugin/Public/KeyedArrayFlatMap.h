@@ -0,0 +1,369 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "KeyedArrayKeyFuncs.h"
+
+/**
+ * Replaces the TMap of a Keyed Array with a flat, open-addressing table using linear probing.
+ *
+ * Every entry is only the key's hash and the index of its pair, so a lookup usually touches a single cache line of
+ * the table plus the pair itself, rather than the TSet's buckets, sparse array and elements. Keys are compared
+ * through the Keyed Array's pairs, which is why the map has to be bound to them (TInternalKeyedArray does so).
+ * Entries are compared by hash first so the pairs are rarely read for anything but the actual match.
+ * Removals shift the following entries back instead of leaving tombstones, so lookups never slow down over time.
+ *
+ * Since keys are read from the pairs, every entry must point at the pair holding its key whenever a key is looked
+ * up. Growing only needs the stored hashes, so it never reads the pairs.
+ * PairAllocatorType has to match the allocator of the pairs array.
+ *
+ * Only the subset of the TMap interface used by TInternalKeyedArray is implemented.
+ */
+template<typename KeyType, typename PairType, typename PairAllocatorType = FDefaultAllocator>
+class TKeyedArrayFlatMap
+{
+	typedef TKeyedArrayKeyFuncs<KeyType> KeyFuncsType;
+
+	struct FEntry
+	{
+		uint32 Hash;
+
+		/** Index of the pair, or INDEX_NONE if the entry is empty. */
+		int32 Index;
+	};
+
+	/** Grows once more than half of the entries are in use. */
+	static constexpr int32 MinCapacity = 16;
+
+	const TArray<PairType, PairAllocatorType>* Pairs;
+	TArray<FEntry> Entries;
+	int32 NumPairs;
+
+	/** Shift applied to the scrambled hash to get the home entry, 32 - log2 of the capacity. */
+	uint32 HashShift;
+
+public:
+	/** What iterating yields. Only the index is available as the pairs may be mid-modification. */
+	template<typename IndexType>
+	struct TEntryRef
+	{
+		IndexType& Value;
+	};
+
+	template<typename EntriesType, typename IndexType>
+	class TBaseIterator
+	{
+		EntriesType& Entries;
+		int32 EntryIndex;
+
+	public:
+		TBaseIterator(EntriesType& InEntries, int32 StartIndex)
+			: Entries(InEntries)
+		{
+			EntryIndex = StartIndex;
+			SkipEmptyEntries();
+		}
+
+		FORCEINLINE TEntryRef<IndexType> operator*() const
+		{
+			return TEntryRef<IndexType>{ Entries[EntryIndex].Index };
+		}
+
+		FORCEINLINE TBaseIterator& operator++()
+		{
+			EntryIndex++;
+			SkipEmptyEntries();
+			return *this;
+		}
+
+		FORCEINLINE bool operator!=(const TBaseIterator& Other) const
+		{
+			return EntryIndex != Other.EntryIndex;
+		}
+
+	private:
+		FORCEINLINE void SkipEmptyEntries()
+		{
+			while (EntryIndex < Entries.Num() && Entries[EntryIndex].Index == INDEX_NONE)
+				EntryIndex++;
+		}
+	};
+
+	typedef TBaseIterator<TArray<FEntry>, int32> TIterator;
+	typedef TBaseIterator<const TArray<FEntry>, const int32> TConstIterator;
+
+	TKeyedArrayFlatMap()
+	{
+		Pairs = nullptr;
+		NumPairs = 0;
+		HashShift = 32;
+	}
+
+	/** Sets the pairs keys are compared through. */
+	FORCEINLINE void Bind(const TArray<PairType, PairAllocatorType>* NewPairs)
+	{
+		Pairs = NewPairs;
+	}
+
+	FORCEINLINE int32 Num() const
+	{
+		return NumPairs;
+	}
+
+	FORCEINLINE int32* Find(const KeyType& Key)
+	{
+		const int32 EntryIndex = FindEntry(Key, KeyFuncsType::GetKeyHash(Key));
+		if (EntryIndex != INDEX_NONE)
+			return &Entries[EntryIndex].Index;
+
+		return nullptr;
+	}
+
+	FORCEINLINE const int32* Find(const KeyType& Key) const
+	{
+		const int32 EntryIndex = FindEntry(Key, KeyFuncsType::GetKeyHash(Key));
+		if (EntryIndex != INDEX_NONE)
+			return &Entries[EntryIndex].Index;
+
+		return nullptr;
+	}
+
+	FORCEINLINE int32& FindChecked(const KeyType& Key)
+	{
+		int32* Index = Find(Key);
+		check(Index);
+		return *Index;
+	}
+
+	FORCEINLINE const int32& FindChecked(const KeyType& Key) const
+	{
+		const int32* Index = Find(Key);
+		check(Index);
+		return *Index;
+	}
+
+	FORCEINLINE bool Contains(const KeyType& Key) const
+	{
+		return Find(Key) != nullptr;
+	}
+
+	/** Like TMap, a new key starts with an index of 0 which the caller is expected to overwrite. */
+	FORCEINLINE int32& FindOrAdd(const KeyType& Key)
+	{
+		const uint32 Hash = KeyFuncsType::GetKeyHash(Key);
+		const int32 ExistingEntryIndex = FindEntry(Key, Hash);
+		if (ExistingEntryIndex != INDEX_NONE)
+			return Entries[ExistingEntryIndex].Index;
+
+		if ((NumPairs + 1) * 2 > Entries.Num())
+			Rehash(FMath::Max(MinCapacity, Entries.Num() * 2));
+
+		NumPairs++;
+		FEntry& Entry = Entries[FindEmptyEntry(Hash)];
+		Entry.Hash = Hash;
+		Entry.Index = 0;
+		return Entry.Index;
+	}
+
+	FORCEINLINE int32& Add(const KeyType& Key, int32 Index)
+	{
+		int32& MappedIndex = FindOrAdd(Key);
+		MappedIndex = Index;
+		return MappedIndex;
+	}
+
+	FORCEINLINE int32 Remove(const KeyType& Key)
+	{
+		int32 Index;
+		return RemoveAndCopyValue(Key, Index) ? 1 : 0;
+	}
+
+	bool RemoveAndCopyValue(const KeyType& Key, int32& OutIndex)
+	{
+		const int32 FoundIndex = FindEntry(Key, KeyFuncsType::GetKeyHash(Key));
+		if (FoundIndex == INDEX_NONE)
+			return false;
+
+		uint32 EmptyIndex = FoundIndex;
+		OutIndex = Entries[EmptyIndex].Index;
+		NumPairs--;
+
+		// Move back every following entry that would still be reachable from its home entry, so no probe sequence
+		// gets broken by the hole.
+		const uint32 Mask = Entries.Num() - 1;
+		for (uint32 Next = (EmptyIndex + 1) & Mask; Entries[Next].Index != INDEX_NONE; Next = (Next + 1) & Mask)
+		{
+			const uint32 Home = GetHomeEntry(Entries[Next].Hash);
+			if (((Next - Home) & Mask) >= ((Next - EmptyIndex) & Mask))
+			{
+				Entries[EmptyIndex] = Entries[Next];
+				EmptyIndex = Next;
+			}
+		}
+
+		Entries[EmptyIndex].Index = INDEX_NONE;
+		return true;
+	}
+
+	/**
+	 * Points the key's entry at the pair's new index after the pair was moved without going through the map (i.e. by
+	 * the Fast Array). The entry is found by its old index rather than by reading keys from the pairs, so they don't
+	 * have to be consistent.
+	 */
+	void Reindex(const KeyType& Key, int32 OldIndex, int32 NewIndex)
+	{
+		if (NumPairs == 0)
+			return;
+
+		const uint32 Hash = KeyFuncsType::GetKeyHash(Key);
+		const uint32 Mask = Entries.Num() - 1;
+		for (uint32 EntryIndex = GetHomeEntry(Hash); Entries[EntryIndex].Index != INDEX_NONE; EntryIndex = (EntryIndex + 1) & Mask)
+		{
+			FEntry& Entry = Entries[EntryIndex];
+			if (Entry.Hash == Hash && Entry.Index == OldIndex)
+			{
+				Entry.Index = NewIndex;
+				return;
+			}
+		}
+
+		checkf(false, TEXT("No entry points at the moved pair's old index %d."), OldIndex);
+	}
+
+	/** Forgets every key. Only reallocates if ExpectedNumElements doesn't fit. */
+	void Empty(int32 ExpectedNumElements = 0)
+	{
+		NumPairs = 0;
+		if (ExpectedNumElements * 2 > Entries.Num())
+		{
+			Entries.Empty();
+			Rehash(GetCapacityFor(ExpectedNumElements));
+		}
+		else if (Entries.Num() > 0)
+			FMemory::Memset(Entries.GetData(), 0xFF, Entries.Num() * sizeof(FEntry));
+	}
+
+	FORCEINLINE void Reset()
+	{
+		Empty();
+	}
+
+	void Reserve(int32 Number)
+	{
+		if (Number * 2 > Entries.Num())
+			Rehash(GetCapacityFor(Number));
+	}
+
+	/** Rehashes into the smallest table that fits the current keys, or frees it if there are none. */
+	void Shrink()
+	{
+		if (NumPairs == 0)
+			Entries.Empty();
+		else if (GetCapacityFor(NumPairs) < Entries.Num())
+			Rehash(GetCapacityFor(NumPairs));
+
+		Entries.Shrink();
+	}
+
+	FORCEINLINE SIZE_T GetAllocatedSize() const
+	{
+		return Entries.GetAllocatedSize();
+	}
+
+	FORCEINLINE TIterator begin() { return TIterator(Entries, 0); }
+	FORCEINLINE TConstIterator begin() const { return TConstIterator(Entries, 0); }
+	FORCEINLINE TIterator end() { return TIterator(Entries, Entries.Num()); }
+	FORCEINLINE TConstIterator end() const { return TConstIterator(Entries, Entries.Num()); }
+
+private:
+	static FORCEINLINE int32 GetCapacityFor(int32 Number)
+	{
+		return FMath::Max(MinCapacity, static_cast<int32>(FMath::RoundUpToPowerOfTwo(Number * 2)));
+	}
+
+	/** Fibonacci hashing, so keys with similar hashes (i.e. consecutive FName indices) still spread out. */
+	FORCEINLINE uint32 GetHomeEntry(uint32 Hash) const
+	{
+		return (Hash * 0x9E3779B9u) >> HashShift;
+	}
+
+	FORCEINLINE int32 FindEntry(const KeyType& Key, uint32 Hash) const
+	{
+		if (NumPairs == 0)
+			return INDEX_NONE;
+
+		const uint32 Mask = Entries.Num() - 1;
+		for (uint32 EntryIndex = GetHomeEntry(Hash); ; EntryIndex = (EntryIndex + 1) & Mask)
+		{
+			const FEntry& Entry = Entries[EntryIndex];
+			if (Entry.Index == INDEX_NONE)
+				return INDEX_NONE;
+
+			if (Entry.Hash == Hash && Pairs->IsValidIndex(Entry.Index) && KeyFuncsType::Matches((*Pairs)[Entry.Index].Key, Key))
+				return EntryIndex;
+		}
+	}
+
+	FORCEINLINE int32 FindEmptyEntry(uint32 Hash) const
+	{
+		const uint32 Mask = Entries.Num() - 1;
+		uint32 EntryIndex = GetHomeEntry(Hash);
+		while (Entries[EntryIndex].Index != INDEX_NONE)
+			EntryIndex = (EntryIndex + 1) & Mask;
+
+		return EntryIndex;
+	}
+
+	/** Only the stored hashes are needed to move the entries, so the pairs don't have to be consistent. */
+	void Rehash(int32 NewCapacity)
+	{
+		TArray<FEntry> OldEntries = MoveTemp(Entries);
+		Entries.SetNumUninitialized(NewCapacity);
+		FMemory::Memset(Entries.GetData(), 0xFF, NewCapacity * sizeof(FEntry));
+		HashShift = 32 - FMath::FloorLog2(NewCapacity);
+
+		for (const FEntry& Entry : OldEntries)
+			if (Entry.Index != INDEX_NONE)
+				Entries[FindEmptyEntry(Entry.Hash)] = Entry;
+	}
+};
+
+template<typename MapType>
+struct TIsKeyedArrayFlatMap
+{
+	enum { Value = false };
+};
+
+template<typename KeyType, typename PairType, typename PairAllocatorType>
+struct TIsKeyedArrayFlatMap<TKeyedArrayFlatMap<KeyType, PairType, PairAllocatorType>>
+{
+	enum { Value = true };
+};
+
+/** Lets TInternalKeyedArray bind its map to the pairs. Does nothing for maps that don't need them. */
+template<typename MapType, typename ArrayType>
+FORCEINLINE void BindKeyedArrayMap(MapType* Map, const ArrayType* Array)
+{
+	// A flat map only ends up here if its pair or allocator type doesn't match the array, and would never be bound.
+	static_assert(!TIsKeyedArrayFlatMap<MapType>::Value, "TKeyedArrayFlatMap's PairType and PairAllocatorType have to match the pairs array.");
+}
+
+template<typename KeyType, typename PairType, typename PairAllocatorType>
+FORCEINLINE void BindKeyedArrayMap(TKeyedArrayFlatMap<KeyType, PairType, PairAllocatorType>* Map, const TArray<PairType, PairAllocatorType>* Array)
+{
+	if (Map)
+		Map->Bind(Array);
+}
+
+/** Lets TInternalKeyedArray point a key at the index its pair was moved to, from OldIndex. */
+template<typename MapType, typename KeyType>
+FORCEINLINE void ReindexKeyedArrayMap(MapType* Map, const KeyType& Key, int32 OldIndex, int32 NewIndex)
+{
+	Map->FindChecked(Key) = NewIndex;
+}
+
+/** Flat maps compare keys through the pairs, which have already moved, so the entry is found by its old index. */
+template<typename KeyType, typename PairType, typename PairAllocatorType>
+FORCEINLINE void ReindexKeyedArrayMap(TKeyedArrayFlatMap<KeyType, PairType, PairAllocatorType>* Map, const KeyType& Key, int32 OldIndex, int32 NewIndex)
+{
+	Map->Reindex(Key, OldIndex, NewIndex);
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "Templates/IsEnum.h"
+#include "Templates/IsIntegral.h"
+
+/**
+ * Hashes the key by using it as its own hash. Used for integers and enums that fit in 32 bits, where hashing
+ * anything else would only cost more without spreading the keys any better.
+ */
+template<typename KeyType>
+struct TKeyedArrayIdentityKeyFuncs : public TDefaultMapKeyFuncs<KeyType, int32, false>
+{
+	static FORCEINLINE bool Matches(KeyType A, KeyType B)
+	{
+		return A == B;
+	}
+
+	static FORCEINLINE uint32 GetKeyHash(KeyType Key)
+	{
+		return static_cast<uint32>(Key);
+	}
+};
+
+/**
+ * Picks the cheapest key functions for the Keyed Array's map at compile time.
+ * Every other key type (i.e. FName, whose hash is already its comparison index, or FGameplayTag, which hashes
+ * its FName) uses the default key functions so its map stays a plain TMap that can be exposed to Blueprints.
+ * Specialise this to give a key type its own key functions.
+ */
+template<typename KeyType, bool bIsIdentityHashable = (TIsIntegral<KeyType>::Value || TIsEnum<KeyType>::Value) && sizeof(KeyType) <= sizeof(uint32)>
+struct TKeyedArrayKeyFuncsSelector
+{
+	typedef TDefaultMapHashableKeyFuncs<KeyType, int32, false> Type;
+};
+
+template<typename KeyType>
+struct TKeyedArrayKeyFuncsSelector<KeyType, true>
+{
+	typedef TKeyedArrayIdentityKeyFuncs<KeyType> Type;
+};
+
+template<typename KeyType>
+using TKeyedArrayKeyFuncs = typename TKeyedArrayKeyFuncsSelector<KeyType>::Type;
+
+/** The map from keys to indices used by every Keyed Array with the given key type. */
+template<typename KeyType>
+using TKeyedArrayMap = TMap<KeyType, int32, FDefaultSetAllocator, TKeyedArrayKeyFuncs<KeyType>>;
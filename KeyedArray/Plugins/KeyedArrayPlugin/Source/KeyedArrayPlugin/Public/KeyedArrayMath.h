@@ -0,0 +1,282 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "Math/VectorRegister.h"
+#include "KeyedArrayMath.generated.h"
+
+
+UENUM(BlueprintType)
+enum class EKeyedArrayCompareOp : uint8
+{
+	Less,
+	LessOrEqual,
+	Greater,
+	GreaterOrEqual,
+	Equal,
+	NotEqual
+};
+
+/**
+ * Aggregate and query kernels over contiguous floats, used by the aggregates of TSoAKeyedArray (i.e. FNameFloatSoAKeyedArray)
+ * and, through a gathered copy of the values, KEYED_ARRAY_FLOAT_AGGREGATES.
+ * Four values are processed at once through the engine's VectorRegister, which is SSE or NEON depending on the
+ * platform and falls back to scalar code where neither is available. The remainder is handled one value at a time.
+ */
+struct FKeyedArrayMath
+{
+	struct FLess
+	{
+		static FORCEINLINE bool Scalar(float Value, float Threshold) { return Value < Threshold; }
+		static FORCEINLINE VectorRegister Vector(VectorRegister Values, VectorRegister Bounds) { return VectorCompareGT(Bounds, Values); }
+	};
+
+	struct FLessOrEqual
+	{
+		static FORCEINLINE bool Scalar(float Value, float Threshold) { return Value <= Threshold; }
+		static FORCEINLINE VectorRegister Vector(VectorRegister Values, VectorRegister Bounds) { return VectorCompareGE(Bounds, Values); }
+	};
+
+	struct FGreater
+	{
+		static FORCEINLINE bool Scalar(float Value, float Threshold) { return Value > Threshold; }
+		static FORCEINLINE VectorRegister Vector(VectorRegister Values, VectorRegister Bounds) { return VectorCompareGT(Values, Bounds); }
+	};
+
+	struct FGreaterOrEqual
+	{
+		static FORCEINLINE bool Scalar(float Value, float Threshold) { return Value >= Threshold; }
+		static FORCEINLINE VectorRegister Vector(VectorRegister Values, VectorRegister Bounds) { return VectorCompareGE(Values, Bounds); }
+	};
+
+	struct FEqual
+	{
+		static FORCEINLINE bool Scalar(float Value, float Threshold) { return Value == Threshold; }
+		static FORCEINLINE VectorRegister Vector(VectorRegister Values, VectorRegister Bounds) { return VectorCompareEQ(Values, Bounds); }
+	};
+
+	struct FNotEqual
+	{
+		static FORCEINLINE bool Scalar(float Value, float Threshold) { return Value != Threshold; }
+		static FORCEINLINE VectorRegister Vector(VectorRegister Values, VectorRegister Bounds) { return VectorCompareNE(Values, Bounds); }
+	};
+
+	static FORCEINLINE bool Compare(EKeyedArrayCompareOp Op, float Value, float Threshold)
+	{
+		return VisitCompare(Op, [Value, Threshold](auto Comparison) { return Comparison.Scalar(Value, Threshold); });
+	}
+
+	/**
+	 * Calls Visitor with the comparison for Op, which has a static Scalar(Value, Threshold) and Vector(Values, Bounds).
+	 * Loops go inside Visitor so that the comparison is picked once rather than for every value.
+	 * Returns what Visitor returns, or a default constructed value if Op is invalid.
+	 */
+	template<typename VisitorType>
+	static FORCEINLINE auto VisitCompare(EKeyedArrayCompareOp Op, VisitorType&& Visitor) -> decltype(Visitor(FLess()))
+	{
+		switch (Op)
+		{
+		case EKeyedArrayCompareOp::Less:			return Visitor(FLess());
+		case EKeyedArrayCompareOp::LessOrEqual:		return Visitor(FLessOrEqual());
+		case EKeyedArrayCompareOp::Greater:			return Visitor(FGreater());
+		case EKeyedArrayCompareOp::GreaterOrEqual:	return Visitor(FGreaterOrEqual());
+		case EKeyedArrayCompareOp::Equal:			return Visitor(FEqual());
+		case EKeyedArrayCompareOp::NotEqual:		return Visitor(FNotEqual());
+		default:									return decltype(Visitor(FLess()))();
+		}
+	}
+
+	static float Sum(TArrayView<const float> Values)
+	{
+		const float* Data = Values.GetData();
+		const int32 Num = Values.Num();
+		int32 i = 0;
+
+		// Two accumulators so consecutive additions don't wait on each other.
+		VectorRegister Accumulator0 = VectorZero();
+		VectorRegister Accumulator1 = VectorZero();
+		for (; i + 8 <= Num; i += 8)
+		{
+			Accumulator0 = VectorAdd(Accumulator0, VectorLoad(Data + i));
+			Accumulator1 = VectorAdd(Accumulator1, VectorLoad(Data + i + 4));
+		}
+
+		for (; i + 4 <= Num; i += 4)
+			Accumulator0 = VectorAdd(Accumulator0, VectorLoad(Data + i));
+
+		float Lanes[4];
+		VectorStore(VectorAdd(Accumulator0, Accumulator1), Lanes);
+		float Total = (Lanes[0] + Lanes[1]) + (Lanes[2] + Lanes[3]);
+
+		for (; i < Num; i++)
+			Total += Data[i];
+
+		return Total;
+	}
+
+	static FORCEINLINE float Average(TArrayView<const float> Values)
+	{
+		return Values.Num() > 0 ? Sum(Values) / Values.Num() : 0.f;
+	}
+
+	/** Index of the first smallest value, or -1 if there are none. */
+	static int32 ArgMin(TArrayView<const float> Values)
+	{
+		return ArgExtreme(Values, [](VectorRegister A, VectorRegister B) { return VectorMin(A, B); }, [](float A, float B) { return FMath::Min(A, B); });
+	}
+
+	/** Index of the first largest value, or -1 if there are none. */
+	static int32 ArgMax(TArrayView<const float> Values)
+	{
+		return ArgExtreme(Values, [](VectorRegister A, VectorRegister B) { return VectorMax(A, B); }, [](float A, float B) { return FMath::Max(A, B); });
+	}
+
+	/** Number of values for which "Value Op Threshold" is true. */
+	static int32 CountWhere(TArrayView<const float> Values, EKeyedArrayCompareOp Op, float Threshold)
+	{
+		return VisitCompare(Op, [Values, Threshold](auto Comparison) { return CountWhere(Values, Threshold, Comparison); });
+	}
+
+	/** Inline storage for the values gathered by KEYED_ARRAY_FLOAT_AGGREGATES, so most arrays don't allocate. */
+	typedef TArray<float, TInlineAllocator<256>> FValueBuffer;
+
+	/** Copies the Value of every pair into OutValues, in order. */
+	template<typename PairType, typename AllocatorType>
+	static void GatherValues(const TArray<PairType>& Pairs, TArray<float, AllocatorType>& OutValues)
+	{
+		const int32 Num = Pairs.Num();
+		OutValues.SetNumUninitialized(Num);
+
+		float* Data = OutValues.GetData();
+		for (int32 i = 0; i < Num; i++)
+			Data[i] = Pairs[i].Value;
+	}
+
+	static void Scale(TArrayView<float> Values, float Scale)
+	{
+		float* Data = Values.GetData();
+		const int32 Num = Values.Num();
+		const VectorRegister Scalar = VectorSetFloat1(Scale);
+
+		int32 i = 0;
+		for (; i + 4 <= Num; i += 4)
+			VectorStore(VectorMultiply(VectorLoad(Data + i), Scalar), Data + i);
+
+		for (; i < Num; i++)
+			Data[i] *= Scale;
+	}
+
+private:
+	template<typename VectorOpType, typename ScalarOpType>
+	static int32 ArgExtreme(TArrayView<const float> Values, VectorOpType VectorOp, ScalarOpType ScalarOp)
+	{
+		const float* Data = Values.GetData();
+		const int32 Num = Values.Num();
+		if (Num == 0)
+			return -1;
+
+		// Find the extreme value four lanes at a time, then the first index holding it.
+		int32 i = 0;
+		float Extreme = Data[0];
+		if (Num >= 4)
+		{
+			VectorRegister Lanes = VectorLoad(Data);
+			for (i = 4; i + 4 <= Num; i += 4)
+				Lanes = VectorOp(Lanes, VectorLoad(Data + i));
+
+			float Stored[4];
+			VectorStore(Lanes, Stored);
+			Extreme = ScalarOp(ScalarOp(Stored[0], Stored[1]), ScalarOp(Stored[2], Stored[3]));
+		}
+
+		for (; i < Num; i++)
+			Extreme = ScalarOp(Extreme, Data[i]);
+
+		for (i = 0; i < Num; i++)
+			if (Data[i] == Extreme)
+				return i;
+
+		return -1;
+	}
+
+	template<typename ComparisonType>
+	static int32 CountWhere(TArrayView<const float> Values, float Threshold, ComparisonType Comparison)
+	{
+		const float* Data = Values.GetData();
+		const int32 Num = Values.Num();
+		const VectorRegister Bound = VectorSetFloat1(Threshold);
+
+		int32 Count = 0;
+		int32 i = 0;
+		for (; i + 4 <= Num; i += 4)
+			Count += FMath::CountBits(static_cast<uint64>(VectorMaskBits(Comparison.Vector(VectorLoad(Data + i), Bound))));
+
+		for (; i < Num; i++)
+			if (Comparison.Scalar(Data[i], Threshold))
+				Count++;
+
+		return Count;
+	}
+};
+
+/**
+ * Aggregates for Keyed Arrays with float values, added to their body after KEYED_ARRAY_BODY.
+ * The pairs interleave keys and values, so the values are first gathered into a contiguous buffer that FKeyedArrayMath
+ * then runs over four at a time. The gather is still a pass over the pairs; keep the values in a TSoAKeyedArray
+ * instead if aggregates are run often over large arrays.
+ */
+#define KEYED_ARRAY_FLOAT_AGGREGATES() \
+	float Sum() const \
+	{ \
+		FKeyedArrayMath::FValueBuffer Values; \
+		FKeyedArrayMath::GatherValues(BackingPairs, Values); \
+		return FKeyedArrayMath::Sum(Values); \
+	} \
+	\
+	float Average() const \
+	{ \
+		return BackingPairs.Num() > 0 ? Sum() / BackingPairs.Num() : 0.f; \
+	} \
+	\
+	/** Index of the first smallest value, or -1 if empty. */ \
+	int32 GetMinIndex() const \
+	{ \
+		FKeyedArrayMath::FValueBuffer Values; \
+		FKeyedArrayMath::GatherValues(BackingPairs, Values); \
+		return FKeyedArrayMath::ArgMin(Values); \
+	} \
+	\
+	/** Index of the first largest value, or -1 if empty. */ \
+	int32 GetMaxIndex() const \
+	{ \
+		FKeyedArrayMath::FValueBuffer Values; \
+		FKeyedArrayMath::GatherValues(BackingPairs, Values); \
+		return FKeyedArrayMath::ArgMax(Values); \
+	} \
+	\
+	/** Number of values for which "Value Op Threshold" is true. */ \
+	int32 CountWhere(EKeyedArrayCompareOp Op, float Threshold) const \
+	{ \
+		FKeyedArrayMath::FValueBuffer Values; \
+		FKeyedArrayMath::GatherValues(BackingPairs, Values); \
+		return FKeyedArrayMath::CountWhere(Values, Op, Threshold); \
+	} \
+	\
+	/** Multiplies every value. Every pair is marked dirty, and OutChanges, if given, receives every key. */ \
+	void ScaleAll(float Scale, FKeyedArrayChangeSet* OutChanges = nullptr) \
+	{ \
+		FKeyedArrayMath::FValueBuffer Values; \
+		FKeyedArrayMath::GatherValues(BackingPairs, Values); \
+		FKeyedArrayMath::Scale(Values, Scale); \
+		\
+		for (int32 i = 0; i < BackingPairs.Num(); i++) \
+		{ \
+			PairType& Pair = BackingPairs[i]; \
+			Pair.Value = Values[i]; \
+			MarkItemDirty(Pair); \
+			if (OutChanges) \
+				OutChanges->MarkChanged(KeyedArrayKeyToName(Pair.Key)); \
+		} \
+		\
+		if (Internal.IsValueIndexEnabled()) \
+			Internal.RebuildValueIndex(); \
+	}
@@ -0,0 +1,195 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "KeyedArrayChangeSet.h"
+#include "UObject/CoreNet.h"
+#include "KeyedArrayNetSerialization.generated.h"
+
+
+/**
+ * FName keys that pairs using the native net serializer (see KEYED_ARRAY_PAIR_TYPE_TRAITS) send as their index in
+ * this list, a few bits each, rather than as a string. Keys that aren't listed are sent as usual.
+ *
+ * The server and clients both read the list from DefaultGame.ini and never exchange it, so it must be the same on
+ * both sides. A checksum of it is sent ahead of the first update of every Keyed Array to a connection (see
+ * NetSerializeChecksum), so a receiver with a different list fails that update rather than reading the wrong keys:
+ *
+ *	[/Script/KeyedArrayPlugin.KeyedArrayKeyDictionary]
+ *	+Keys=Health
+ *	+Keys=Stamina
+ */
+UCLASS(Config=Game, DefaultConfig)
+class KEYEDARRAYPLUGIN_API UKeyedArrayKeyDictionary : public UObject
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Config)
+	TArray<FName> Keys;
+
+	TMap<FName, int32> KeyIndices;
+
+	uint32 Checksum = 0;
+
+public:
+	virtual void PostInitProperties() override;
+
+	virtual void PostReloadConfig(FProperty* PropertyThatWasLoaded) override;
+
+	/** Writes the key as its index in the dictionary if it's listed, or as a regular FName otherwise. Reads it back. */
+	static bool NetSerializeKey(FArchive& Ar, FName& Key);
+
+	/** Same as NetSerializeKey, through this dictionary rather than the configured one. */
+	bool SerializeKey(FArchive& Ar, FName& Key) const;
+
+	/** Replaces the keys, i.e. in tests. Only the configured keys are checked against the sender's. */
+	void SetKeys(const TArray<FName>& InKeys);
+
+	/** Checksum of the keys, ignoring their case like FNames do. 0 when no keys are listed. */
+	FORCEINLINE uint32 GetChecksum() const
+	{
+		return Checksum;
+	}
+
+	/**
+	 * Sends the checksum of the configured keys ahead of the first update of a Keyed Array to a connection, that is
+	 * until the connection has a base state for it, and checks it on the receiving side. A mismatch sets an error on
+	 * the reader before any key is read. Costs a bit per update on top of the 32-bit checksum, which isn't sent while
+	 * no keys are listed. Kept per connection so that the network version and replays aren't affected by the list.
+	 */
+	static bool NetSerializeChecksum(FNetDeltaSerializeInfo& DeltaParms);
+
+	/** Same as NetSerializeChecksum, through this dictionary rather than the configured one. bSend is ignored when loading. */
+	bool SerializeChecksum(FArchive& Ar, bool bSend) const;
+
+private:
+	void RebuildKeyIndices();
+};
+
+/** How the native net serializer of a pair sends its key. Add overloads for key types that FArchive can't handle. */
+FORCEINLINE bool KeyedArrayNetSerializeKey(FArchive& Ar, UPackageMap* Map, FName& Key)
+{
+	return UKeyedArrayKeyDictionary::NetSerializeKey(Ar, Key);
+}
+
+template<typename KeyType>
+FORCEINLINE bool KeyedArrayNetSerializeKey(FArchive& Ar, UPackageMap* Map, KeyType& Key)
+{
+	Ar << Key;
+	return true;
+}
+
+UENUM(BlueprintType)
+enum class EKeyedArrayQuantization : uint8
+{
+	/** Sent as a full 32-bit float. */
+	None,
+
+	/** Sent as a 16-bit float, keeping about 3 significant digits. */
+	Half,
+
+	/** Clamped to [Min, Max] and sent as a NumBits integer, so in steps of (Max - Min) / (2^NumBits - 1). */
+	Fixed
+};
+
+/** How a float value is replicated. i.e. a range of 0 to 100 with 0.01 precision needs 14 bits. */
+USTRUCT(BlueprintType)
+struct KEYEDARRAYPLUGIN_API FKeyedArrayValueQuantization
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EKeyedArrayQuantization Mode = EKeyedArrayQuantization::None;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "Mode == EKeyedArrayQuantization::Fixed"))
+	float Min = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "Mode == EKeyedArrayQuantization::Fixed"))
+	float Max = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (EditCondition = "Mode == EKeyedArrayQuantization::Fixed", ClampMin = 1, ClampMax = 24))
+	int32 NumBits = 16;
+
+public:
+	/** Writes the value, or reads it back dequantized. */
+	bool SerializeValue(FArchive& Ar, float& Value) const;
+
+	/** How many bits a value takes on the wire. */
+	int32 GetNumBits() const;
+};
+
+/**
+ * The quantization of a Keyed Array's float values, with optional overrides per key.
+ * A Keyed Array opts in by declaring it as a NetQuantization UPROPERTY (NotReplicated) next to its BackingPairs, along
+ * with KEYED_ARRAY_PAIR_TYPE_TRAITS for its pair. The settings aren't replicated, so they have to be the same on the
+ * server and clients, i.e. set on the component's defaults.
+ */
+USTRUCT(BlueprintType)
+struct KEYEDARRAYPLUGIN_API FKeyedArrayNetQuantization
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FKeyedArrayValueQuantization Default;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TMap<FName, FKeyedArrayValueQuantization> PerKey;
+
+public:
+	template<typename KeyType>
+	FORCEINLINE const FKeyedArrayValueQuantization& Get(const KeyType& Key) const
+	{
+		if (PerKey.Num() > 0)
+		{
+			if (const FKeyedArrayValueQuantization* Found = PerKey.Find(KeyedArrayKeyToName(Key)))
+				return *Found;
+		}
+
+		return Default;
+	}
+
+	/** The quantization of the Keyed Array being net serialized on this thread, if any. */
+	static const FKeyedArrayNetQuantization* GetCurrent();
+
+	/** Makes the quantization current for as long as the scope lives, i.e. around FastArrayDeltaSerialize. */
+	struct KEYEDARRAYPLUGIN_API FScope
+	{
+		explicit FScope(const FKeyedArrayNetQuantization* Quantization);
+		~FScope();
+
+		FScope(const FScope&) = delete;
+		FScope& operator=(const FScope&) = delete;
+
+	private:
+		const FKeyedArrayNetQuantization* Previous;
+	};
+};
+
+/**
+ * How the native net serializer of a pair sends its value. Objects go through the package map, and floats through
+ * the quantization of the Keyed Array being serialized.
+ */
+template<typename KeyType>
+FORCEINLINE bool KeyedArrayNetSerializeValue(FArchive& Ar, UPackageMap* Map, const KeyType& Key, float& Value)
+{
+	if (const FKeyedArrayNetQuantization* Quantization = FKeyedArrayNetQuantization::GetCurrent())
+		return Quantization->Get(Key).SerializeValue(Ar, Value);
+
+	Ar << Value;
+	return true;
+}
+
+template<typename KeyType, typename ObjectType>
+FORCEINLINE bool KeyedArrayNetSerializeValue(FArchive& Ar, UPackageMap* Map, const KeyType& Key, ObjectType*& Value)
+{
+	UObject* Object = Value;
+	const bool bSuccess = Map->SerializeObject(Ar, ObjectType::StaticClass(), Object);
+	Value = Cast<ObjectType>(Object);
+	return bSuccess;
+}
+
+template<typename KeyType, typename ValueType>
+FORCEINLINE bool KeyedArrayNetSerializeValue(FArchive& Ar, UPackageMap* Map, const KeyType& Key, ValueType& Value)
+{
+	Ar << Value;
+	return true;
+}
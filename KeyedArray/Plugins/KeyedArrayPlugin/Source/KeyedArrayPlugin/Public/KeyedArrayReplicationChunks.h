@@ -0,0 +1,124 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "KeyedArrayChangeSet.h"
+#include "KeyedArrayReplicationConditions.h"
+#include "Net/Serialization/FastArraySerializer.h"
+
+
+class UKeyedArrayComponent;
+
+/**
+ * Spreads the pairs a connection hasn't received yet across several updates when a Keyed Array component sets
+ * MaxBytesPerUpdate, so a large Keyed Array doesn't stall the initial replication of its actor on bunch size limits.
+ * The pairs with the highest KeyPriorities go first. Pairs the connection already has are always sent when they
+ * change, since the Fast Array would otherwise remove them on the client.
+ *
+ * Every update ends with a bit telling whether pairs are still to come, followed by how many if so, which is how
+ * clients know they are fully synced. It's written whether MaxBytesPerUpdate is set or not, since clients can't know.
+ */
+class KEYEDARRAYPLUGIN_API FKeyedArrayChunkScope
+{
+public:
+	explicit FKeyedArrayChunkScope(FNetDeltaSerializeInfo& DeltaParms);
+	~FKeyedArrayChunkScope();
+
+	FKeyedArrayChunkScope(const FKeyedArrayChunkScope&) = delete;
+	FKeyedArrayChunkScope& operator=(const FKeyedArrayChunkScope&) = delete;
+
+	/** Whether the pairs to write are picked here, so what gets written depends on the connection. */
+	FORCEINLINE bool IsLimiting() const
+	{
+		return bLimiting;
+	}
+
+	/** On clients, how many more pairs the server has yet to send after the update that was just received. */
+	FORCEINLINE int32 GetNumPairsToCome() const
+	{
+		return NumPairsToCome;
+	}
+
+	/** Picks which of the pairs the connection hasn't received yet fit in this update. */
+	template<typename PairType>
+	void SelectPairs(const TArray<PairType>& Pairs)
+	{
+		const FNetFastTArrayBaseState* OldState = static_cast<const FNetFastTArrayBaseState*>(DeltaParms.OldState);
+
+		TArray<int32> PendingPairs;
+		for (int32 i = 0; i < Pairs.Num(); i++)
+		{
+			const PairType& Pair = Pairs[i];
+			if (OldState && Pair.ReplicationID != INDEX_NONE && OldState->IDToCLMap.Contains(Pair.ReplicationID))
+				continue;
+
+			if (FKeyedArrayReplicationConditions::ShouldReplicate(Pair.Key))
+				PendingPairs.Add(i);
+		}
+
+		SelectPendingPairs(Pairs.GetData(), Pairs.Num(), PendingPairs, [&Pairs](int32 Index)
+		{
+			return KeyedArrayKeyToName(Pairs[Index].Key);
+		});
+	}
+
+	/** Whether the pair is written to the connection being serialized on this thread. */
+	template<typename PairType>
+	static FORCEINLINE bool ShouldWrite(const PairType& Pair)
+	{
+		const FKeyedArrayChunkScope* Scope = GetCurrent();
+		return !Scope || Scope->SelectedPairs[&Pair - static_cast<const PairType*>(Scope->FirstPair)];
+	}
+
+	/** How many bits have been written so far, to pass to RecordPairBits once the pair is written. */
+	static FORCEINLINE int64 GetNumBitsWritten()
+	{
+		const FKeyedArrayChunkScope* Scope = GetCurrent();
+		return Scope ? Scope->DeltaParms.Writer->GetNumBits() : 0;
+	}
+
+	/**
+	 * Called by the pair NetSerialize once written, so that BytesPerPairEstimate only counts the pairs the budget is
+	 * spent on, rather than the whole update along with the changes to pairs the connection already has.
+	 */
+	template<typename PairType>
+	static FORCEINLINE void RecordPairBits(const PairType& Pair, int64 StartBits)
+	{
+		FKeyedArrayChunkScope* Scope = GetCurrent();
+		if (!Scope)
+			return;
+
+		const int32 Index = static_cast<int32>(&Pair - static_cast<const PairType*>(Scope->FirstPair));
+		if (Scope->NewPairs.IsValidIndex(Index) && Scope->NewPairs[Index])
+		{
+			Scope->NewPairBits += Scope->DeltaParms.Writer->GetNumBits() - StartBits;
+			Scope->NumNewPairsMeasured++;
+		}
+	}
+
+	/** Sends or receives how many pairs are still to come. Call after FastArrayDeltaSerialize with what it returned. */
+	bool Finish(bool bSerialized);
+
+private:
+	static FKeyedArrayChunkScope* GetCurrent();
+
+	/** GetKeyName is only called when KeyPriorities are set and not every pending pair fits. */
+	void SelectPendingPairs(const void* Pairs, int32 NumPairs, TArray<int32>& PendingPairs, TFunctionRef<FName(int32)> GetKeyName);
+
+	FNetDeltaSerializeInfo& DeltaParms;
+	UKeyedArrayComponent* Component = nullptr;
+	FKeyedArrayChunkScope* Previous;
+
+	/** Every pair the connection already has, along with the pending ones that fit in this update. */
+	TBitArray<> SelectedPairs;
+
+	/** The pending pairs that fit in this update. */
+	TBitArray<> NewPairs;
+
+	const void* FirstPair = nullptr;
+	int32 NumSelected = 0;
+	int32 NumPairsToCome = 0;
+	int64 StartBits = 0;
+	int64 NewPairBits = 0;
+	int32 NumNewPairsMeasured = 0;
+	bool bLimiting = false;
+};
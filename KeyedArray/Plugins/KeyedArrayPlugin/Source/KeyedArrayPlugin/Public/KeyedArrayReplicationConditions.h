@@ -0,0 +1,127 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "KeyedArrayChangeSet.h"
+#include "KeyedArrayReplicationConditions.generated.h"
+
+
+class UKeyedArrayComponent;
+class UNetConnection;
+struct FNetDeltaSerializeInfo;
+
+UENUM(BlueprintType)
+enum class EKeyedArrayKeyCondition : uint8
+{
+	/** Sent to every connection the component is relevant to. */
+	None,
+
+	/** Only sent to the connection that owns the actor. */
+	OwnerOnly,
+
+	/** Sent to every connection but the one that owns the actor. */
+	SkipOwner,
+
+	/** Sent to the connections UKeyedArrayComponent::ShouldReplicateKey returns true for. */
+	Custom
+};
+
+/**
+ * Which connections each key of a Keyed Array component is replicated to. Evaluated by the delta serializer for
+ * every connection, so a connection that a key isn't meant for never receives it, and clients only see the pairs
+ * they are allowed to (i.e. the hidden stats and cooldowns of their own character).
+ * A key that stops being sent to a connection is removed from that client's Keyed Array.
+ */
+USTRUCT(BlueprintType)
+struct KEYEDARRAYPLUGIN_API FKeyedArrayReplicationConditions
+{
+	GENERATED_BODY()
+
+	/** The condition of every key that doesn't have its own. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	EKeyedArrayKeyCondition Default = EKeyedArrayKeyCondition::None;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TMap<FName, EKeyedArrayKeyCondition> PerKey;
+
+public:
+	FORCEINLINE EKeyedArrayKeyCondition Get(const FName Key) const
+	{
+		if (PerKey.Num() > 0)
+		{
+			if (const EKeyedArrayKeyCondition* Found = PerKey.Find(Key))
+				return *Found;
+		}
+
+		return Default;
+	}
+
+	/** Whether every key is sent to every connection, in which case nothing has to be evaluated. */
+	bool IsUnconditional() const;
+
+	/** Whether some keys may be sent to a connection and others not, so each one has to be evaluated. */
+	bool DependsOnKey() const;
+
+	/**
+	 * Whether the pair with the given key is sent to the connection being serialized on this thread.
+	 * The key is only converted to an FName when the conditions depend on it.
+	 */
+	template<typename KeyType>
+	static FORCEINLINE bool ShouldReplicate(const KeyType& Key)
+	{
+		const FContext* Context = GetCurrent();
+		if (!Context)
+			return true;
+
+		if (!Context->bDependsOnKey)
+			return Context->bReplicateEveryKey;
+
+		return ShouldReplicateName(KeyedArrayKeyToName(Key));
+	}
+
+	/** The component and connection the conditions are evaluated for. */
+	struct FContext
+	{
+		const UKeyedArrayComponent* Component = nullptr;
+		const UNetConnection* Connection = nullptr;
+		bool bIsOwner = false;
+
+		/** Unless the conditions depend on the key, the Default condition is evaluated once into bReplicateEveryKey. */
+		bool bDependsOnKey = true;
+		bool bReplicateEveryKey = true;
+	};
+
+	/**
+	 * Makes the conditions of the component being serialized current for as long as the scope lives, i.e. around
+	 * FastArrayDeltaSerialize. Does nothing when reading, writing on a client (replays), when the component doesn't
+	 * have any conditions, or when the Keyed Array being serialized isn't a property of a UKeyedArrayComponent.
+	 */
+	struct KEYEDARRAYPLUGIN_API FScope
+	{
+		explicit FScope(const FNetDeltaSerializeInfo& DeltaParms);
+
+		/** Makes the conditions of the component current for the given connection, i.e. in tests. */
+		FScope(const UKeyedArrayComponent* Component, const UNetConnection* Connection, bool bIsOwner);
+
+		~FScope();
+
+		/** Whether the conditions are being evaluated, so what gets written depends on the connection. */
+		FORCEINLINE bool IsActive() const
+		{
+			return Context.Component != nullptr;
+		}
+
+		FScope(const FScope&) = delete;
+		FScope& operator=(const FScope&) = delete;
+
+	private:
+		void Begin(const UKeyedArrayComponent* Component, const UNetConnection* Connection, bool bIsOwner);
+
+		FContext Context;
+		const FContext* Previous;
+	};
+
+private:
+	static const FContext* GetCurrent();
+
+	static bool ShouldReplicateName(const FName Key);
+};
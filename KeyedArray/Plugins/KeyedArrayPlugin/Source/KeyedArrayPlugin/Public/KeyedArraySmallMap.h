@@ -0,0 +1,273 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "KeyedArrayKeyFuncs.h"
+
+/**
+ * Replaces the TMap of a Keyed Array that usually holds only a few keys.
+ *
+ * Up to NumInlineKeys keys are stored inline next to their index, inside the map itself, and looked up by comparing
+ * every one of them. That's faster than hashing at these sizes and the map never allocates. Once more keys are added
+ * they are moved into a regular TMap, which is kept until Empty or Shrink when there are few enough keys again.
+ *
+ * Only the subset of the TMap interface used by TInternalKeyedArray is implemented.
+ */
+template<typename KeyType, int32 NumInlineKeys = 8>
+class TKeyedArraySmallMap
+{
+	typedef TKeyedArrayKeyFuncs<KeyType> KeyFuncsType;
+	typedef TKeyedArrayMap<KeyType> LargeMapType;
+
+	struct FInlineEntry
+	{
+		KeyType Key;
+		int32 Value;
+	};
+
+	typedef TArray<FInlineEntry, TInlineAllocator<NumInlineKeys>> InlineEntriesType;
+
+	InlineEntriesType InlineEntries;
+	LargeMapType LargeMap;
+
+	/** Whether the keys are in LargeMap rather than InlineEntries. */
+	bool bLarge;
+
+public:
+	/** What iterating yields, mirroring the Key and Value of a TMap's pairs. */
+	template<typename IndexType>
+	struct TEntry
+	{
+		KeyType Key;
+		IndexType& Value;
+	};
+
+	template<typename EntriesType, typename LargeIteratorType, typename IndexType>
+	class TBaseIterator
+	{
+		EntriesType& Entries;
+		LargeIteratorType LargeIt;
+		int32 EntryIndex;
+		bool bLarge;
+
+	public:
+		TBaseIterator(EntriesType& InEntries, LargeIteratorType InLargeIt, bool bInLarge, int32 StartIndex)
+			: Entries(InEntries)
+			, LargeIt(InLargeIt)
+		{
+			EntryIndex = StartIndex;
+			bLarge = bInLarge;
+		}
+
+		FORCEINLINE TEntry<IndexType> operator*() const
+		{
+			if (bLarge)
+				return TEntry<IndexType>{ LargeIt.Key(), LargeIt.Value() };
+
+			return TEntry<IndexType>{ Entries[EntryIndex].Key, Entries[EntryIndex].Value };
+		}
+
+		FORCEINLINE TBaseIterator& operator++()
+		{
+			if (bLarge)
+				++LargeIt;
+			else
+				EntryIndex++;
+
+			return *this;
+		}
+
+		/** Only meant for comparing against end(). */
+		FORCEINLINE bool operator!=(const TBaseIterator& Other) const
+		{
+			return bLarge ? static_cast<bool>(LargeIt) : EntryIndex != Other.EntryIndex;
+		}
+	};
+
+	typedef TBaseIterator<InlineEntriesType, typename LargeMapType::TIterator, int32> TIterator;
+	typedef TBaseIterator<const InlineEntriesType, typename LargeMapType::TConstIterator, const int32> TConstIterator;
+
+	TKeyedArraySmallMap()
+	{
+		bLarge = false;
+	}
+
+	/** Whether the keys have outgrown the inline storage. */
+	FORCEINLINE bool IsLarge() const
+	{
+		return bLarge;
+	}
+
+	FORCEINLINE int32 Num() const
+	{
+		return bLarge ? LargeMap.Num() : InlineEntries.Num();
+	}
+
+	FORCEINLINE int32* Find(const KeyType& Key)
+	{
+		if (bLarge)
+			return LargeMap.Find(Key);
+
+		const int32 EntryIndex = FindInlineEntry(Key);
+		return EntryIndex != INDEX_NONE ? &InlineEntries[EntryIndex].Value : nullptr;
+	}
+
+	FORCEINLINE const int32* Find(const KeyType& Key) const
+	{
+		if (bLarge)
+			return LargeMap.Find(Key);
+
+		const int32 EntryIndex = FindInlineEntry(Key);
+		return EntryIndex != INDEX_NONE ? &InlineEntries[EntryIndex].Value : nullptr;
+	}
+
+	FORCEINLINE int32& FindChecked(const KeyType& Key)
+	{
+		int32* Index = Find(Key);
+		check(Index);
+		return *Index;
+	}
+
+	FORCEINLINE const int32& FindChecked(const KeyType& Key) const
+	{
+		const int32* Index = Find(Key);
+		check(Index);
+		return *Index;
+	}
+
+	FORCEINLINE bool Contains(const KeyType& Key) const
+	{
+		return Find(Key) != nullptr;
+	}
+
+	/** Like TMap, a new key starts with an index of 0 which the caller is expected to overwrite. */
+	FORCEINLINE int32& FindOrAdd(const KeyType& Key)
+	{
+		if (!bLarge)
+		{
+			const int32 EntryIndex = FindInlineEntry(Key);
+			if (EntryIndex != INDEX_NONE)
+				return InlineEntries[EntryIndex].Value;
+
+			if (InlineEntries.Num() < NumInlineKeys)
+			{
+				FInlineEntry& Entry = InlineEntries.AddDefaulted_GetRef();
+				Entry.Key = Key;
+				Entry.Value = 0;
+				return Entry.Value;
+			}
+
+			MoveToLargeMap(NumInlineKeys * 2);
+		}
+
+		return LargeMap.FindOrAdd(Key);
+	}
+
+	FORCEINLINE int32& Add(const KeyType& Key, int32 Index)
+	{
+		int32& MappedIndex = FindOrAdd(Key);
+		MappedIndex = Index;
+		return MappedIndex;
+	}
+
+	FORCEINLINE int32 Remove(const KeyType& Key)
+	{
+		int32 Index;
+		return RemoveAndCopyValue(Key, Index) ? 1 : 0;
+	}
+
+	FORCEINLINE bool RemoveAndCopyValue(const KeyType& Key, int32& OutIndex)
+	{
+		if (bLarge)
+			return LargeMap.RemoveAndCopyValue(Key, OutIndex);
+
+		const int32 EntryIndex = FindInlineEntry(Key);
+		if (EntryIndex == INDEX_NONE)
+			return false;
+
+		OutIndex = InlineEntries[EntryIndex].Value;
+		InlineEntries.RemoveAtSwap(EntryIndex, 1, false);
+		return true;
+	}
+
+	/** Forgets every key. Goes back to the inline storage unless ExpectedNumElements doesn't fit in it. */
+	void Empty(int32 ExpectedNumElements = 0)
+	{
+		InlineEntries.Reset();
+		if (ExpectedNumElements > NumInlineKeys)
+		{
+			LargeMap.Empty(ExpectedNumElements);
+			bLarge = true;
+		}
+		else
+		{
+			LargeMap.Empty();
+			bLarge = false;
+		}
+	}
+
+	FORCEINLINE void Reset()
+	{
+		Empty();
+	}
+
+	void Reserve(int32 Number)
+	{
+		if (bLarge)
+			LargeMap.Reserve(Number);
+		else if (Number > NumInlineKeys)
+			MoveToLargeMap(Number);
+	}
+
+	/** Moves the keys back to the inline storage if they fit again. */
+	void Shrink()
+	{
+		if (!bLarge)
+			return;
+
+		if (LargeMap.Num() > NumInlineKeys)
+		{
+			LargeMap.Shrink();
+			return;
+		}
+
+		for (const TPair<KeyType, int32>& Pair : LargeMap)
+		{
+			FInlineEntry& Entry = InlineEntries.AddDefaulted_GetRef();
+			Entry.Key = Pair.Key;
+			Entry.Value = Pair.Value;
+		}
+
+		LargeMap.Empty();
+		bLarge = false;
+	}
+
+	FORCEINLINE SIZE_T GetAllocatedSize() const
+	{
+		return InlineEntries.GetAllocatedSize() + LargeMap.GetAllocatedSize();
+	}
+
+	FORCEINLINE TIterator begin() { return TIterator(InlineEntries, LargeMap.CreateIterator(), bLarge, 0); }
+	FORCEINLINE TConstIterator begin() const { return TConstIterator(InlineEntries, LargeMap.CreateConstIterator(), bLarge, 0); }
+	FORCEINLINE TIterator end() { return TIterator(InlineEntries, LargeMap.CreateIterator(), bLarge, InlineEntries.Num()); }
+	FORCEINLINE TConstIterator end() const { return TConstIterator(InlineEntries, LargeMap.CreateConstIterator(), bLarge, InlineEntries.Num()); }
+
+private:
+	FORCEINLINE int32 FindInlineEntry(const KeyType& Key) const
+	{
+		for (int32 i = 0; i < InlineEntries.Num(); i++)
+			if (KeyFuncsType::Matches(InlineEntries[i].Key, Key))
+				return i;
+
+		return INDEX_NONE;
+	}
+
+	void MoveToLargeMap(int32 ExpectedNumElements)
+	{
+		LargeMap.Reserve(ExpectedNumElements);
+		for (const FInlineEntry& Entry : InlineEntries)
+			LargeMap.Add(Entry.Key, Entry.Value);
+
+		InlineEntries.Reset();
+		bLarge = true;
+	}
+};
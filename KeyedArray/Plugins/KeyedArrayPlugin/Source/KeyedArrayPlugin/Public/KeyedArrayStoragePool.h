@@ -0,0 +1,137 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Templates/UniquePtr.h"
+#include "KeyedArrayStoragePool.generated.h"
+
+
+/** The allocations of a Keyed Array's pairs and map, emptied but keeping their capacity. */
+struct FKeyedArrayPooledStorage
+{
+	virtual ~FKeyedArrayPooledStorage() = default;
+
+	virtual SIZE_T GetAllocatedSize() const = 0;
+};
+
+template<typename PairType, typename MapType>
+struct TKeyedArrayPooledStorage : public FKeyedArrayPooledStorage
+{
+	TArray<PairType> Pairs;
+	MapType Map;
+
+	virtual SIZE_T GetAllocatedSize() const override
+	{
+		return Pairs.GetAllocatedSize() + Map.GetAllocatedSize();
+	}
+};
+
+USTRUCT(BlueprintType)
+struct FKeyedArrayStoragePoolStats
+{
+	GENERATED_BODY()
+
+	/** Keyed Arrays that were given pooled storage. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Hits = 0;
+
+	/** Keyed Arrays that asked for storage while none of their type was pooled. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Misses = 0;
+
+	/** Keyed Arrays whose storage was put back into the pool. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Returns = 0;
+
+	/** Keyed Arrays whose storage was freed instead because the pool was full. */
+	UPROPERTY(BlueprintReadOnly)
+	int32 Discards = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int32 NumPooled = 0;
+
+	UPROPERTY(BlueprintReadOnly)
+	int64 PooledBytes = 0;
+};
+
+/**
+ *  Recycles the storage of Keyed Arrays within a world, so that spawning and destroying many actors carrying Keyed
+ *  Array components (with bUseStoragePool) reuses the same allocations rather than going through the global heap.
+ *  Storage is pooled per Keyed Array type, up to KeyedArray.Pool.MaxPerType of each. Game thread only.
+ */
+UCLASS()
+class UKeyedArrayStoragePool : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+	struct FBucket
+	{
+		/** Storages below NumFilled hold allocations; the ones after are kept empty for the next release. */
+		TArray<TUniquePtr<FKeyedArrayPooledStorage>> Storages;
+		int32 NumFilled = 0;
+	};
+
+	TMap<const UScriptStruct*, FBucket> Buckets;
+	FKeyedArrayStoragePoolStats Stats;
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Gives pooled storage to an empty Keyed Array. Returns false if none of its type was pooled. */
+	template<typename KeyedArrayType>
+	bool Acquire(KeyedArrayType& KeyedArray)
+	{
+		typedef TKeyedArrayPooledStorage<typename KeyedArrayType::PairType, typename KeyedArrayType::MapType> StorageType;
+
+		FBucket* Bucket = Buckets.Find(KeyedArrayType::StaticStruct());
+		if (!Bucket || Bucket->NumFilled == 0 || KeyedArray.Num() > 0)
+		{
+			Stats.Misses++;
+			return false;
+		}
+
+		StorageType& Storage = static_cast<StorageType&>(*Bucket->Storages[--Bucket->NumFilled]);
+		Stats.Hits++;
+		Stats.NumPooled--;
+		Stats.PooledBytes -= Storage.GetAllocatedSize();
+
+		KeyedArray.AdoptStorage(Storage);
+		return true;
+	}
+
+	/** Empties the Keyed Array and moves its storage into the pool, unless the pool for its type is full. */
+	template<typename KeyedArrayType>
+	void Release(KeyedArrayType& KeyedArray)
+	{
+		typedef TKeyedArrayPooledStorage<typename KeyedArrayType::PairType, typename KeyedArrayType::MapType> StorageType;
+
+		if (KeyedArray.GetAllocatedSize() == 0)
+			return;
+
+		FBucket& Bucket = Buckets.FindOrAdd(KeyedArrayType::StaticStruct());
+		if (Bucket.NumFilled >= GetMaxPooledPerType())
+		{
+			Stats.Discards++;
+			return;
+		}
+
+		if (Bucket.NumFilled == Bucket.Storages.Num())
+			Bucket.Storages.Add(MakeUnique<StorageType>());
+
+		StorageType& Storage = static_cast<StorageType&>(*Bucket.Storages[Bucket.NumFilled++]);
+		KeyedArray.ReleaseStorage(Storage);
+		Stats.Returns++;
+		Stats.NumPooled++;
+		Stats.PooledBytes += Storage.GetAllocatedSize();
+	}
+
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	FKeyedArrayStoragePoolStats GetStats() const;
+
+	/** Frees every pooled storage, i.e. once a spawn wave is over. Stats are kept. */
+	UFUNCTION(BlueprintCallable)
+	void Trim();
+
+private:
+	static int32 GetMaxPooledPerType();
+};
@@ -0,0 +1,138 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "Templates/Function.h"
+#include "Templates/UniquePtr.h"
+
+/**
+ * What a Keyed Array needs from its value index, without naming how values are looked up. Keyed Arrays only hold one
+ * of these once the index gets enabled, so values don't need GetTypeHash unless it is.
+ */
+template<typename KeyType, typename ValueType>
+class TKeyedArrayValueIndexBase
+{
+public:
+	virtual ~TKeyedArrayValueIndexBase() = default;
+
+	virtual TKeyedArrayValueIndexBase* Clone() const = 0;
+
+	/** Points the index at the key's current value. */
+	virtual void Index(const KeyType& Key, const ValueType& Item) = 0;
+
+	virtual void Unindex(const KeyType& Key) = 0;
+
+	/** Calls Visitor with every key indexed under the value. */
+	virtual void ForEachKey(const ValueType& Item, TFunctionRef<void(const KeyType&)> Visitor) const = 0;
+
+	virtual void Reset(int32 ExpectedNum) = 0;
+
+	virtual void Shrink() = 0;
+
+	virtual SIZE_T GetAllocatedSize() const = 0;
+};
+
+/**
+ * The default value index, a multimap of values to keys.
+ * IndexedValues remembers the value each key was indexed under, since replicated changes only come through once the
+ * old value has already been overwritten.
+ */
+template<typename KeyType, typename ValueType>
+class TKeyedArrayValueIndex : public TKeyedArrayValueIndexBase<KeyType, ValueType>
+{
+	TMultiMap<ValueType, KeyType> ValueIndex;
+	TMap<KeyType, ValueType> IndexedValues;
+
+public:
+	virtual TKeyedArrayValueIndexBase<KeyType, ValueType>* Clone() const override
+	{
+		return new TKeyedArrayValueIndex(*this);
+	}
+
+	virtual void Index(const KeyType& Key, const ValueType& Item) override
+	{
+		if (ValueType* OldItem = IndexedValues.Find(Key))
+		{
+			if (*OldItem == Item)
+				return;
+
+			ValueIndex.RemoveSingle(*OldItem, Key);
+			*OldItem = Item;
+		}
+		else
+		{
+			IndexedValues.Add(Key, Item);
+		}
+
+		ValueIndex.Add(Item, Key);
+	}
+
+	virtual void Unindex(const KeyType& Key) override
+	{
+		ValueType OldItem;
+		if (IndexedValues.RemoveAndCopyValue(Key, OldItem))
+			ValueIndex.RemoveSingle(OldItem, Key);
+	}
+
+	virtual void ForEachKey(const ValueType& Item, TFunctionRef<void(const KeyType&)> Visitor) const override
+	{
+		for (typename TMultiMap<ValueType, KeyType>::TConstKeyIterator It = ValueIndex.CreateConstKeyIterator(Item); It; ++It)
+			Visitor(It.Value());
+	}
+
+	virtual void Reset(int32 ExpectedNum) override
+	{
+		ValueIndex.Reset();
+		IndexedValues.Reset();
+		ValueIndex.Reserve(ExpectedNum);
+		IndexedValues.Reserve(ExpectedNum);
+	}
+
+	virtual void Shrink() override
+	{
+		ValueIndex.Shrink();
+		IndexedValues.Shrink();
+	}
+
+	virtual SIZE_T GetAllocatedSize() const override
+	{
+		return sizeof(*this) + ValueIndex.GetAllocatedSize() + IndexedValues.GetAllocatedSize();
+	}
+};
+
+/** Owns a Keyed Array's value index, if it has one. Copying a Keyed Array copies its index along with it. */
+template<typename KeyType, typename ValueType>
+class TKeyedArrayValueIndexPtr
+{
+	TUniquePtr<TKeyedArrayValueIndexBase<KeyType, ValueType>> Ptr;
+
+public:
+	TKeyedArrayValueIndexPtr() = default;
+
+	TKeyedArrayValueIndexPtr(const TKeyedArrayValueIndexPtr& Other)
+		: Ptr(Other.Ptr.IsValid() ? Other.Ptr->Clone() : nullptr)
+	{
+	}
+
+	TKeyedArrayValueIndexPtr& operator=(const TKeyedArrayValueIndexPtr& Other)
+	{
+		if (this != &Other)
+			Ptr.Reset(Other.Ptr.IsValid() ? Other.Ptr->Clone() : nullptr);
+
+		return *this;
+	}
+
+	FORCEINLINE void Reset(TKeyedArrayValueIndexBase<KeyType, ValueType>* NewIndex = nullptr)
+	{
+		Ptr.Reset(NewIndex);
+	}
+
+	FORCEINLINE bool IsValid() const
+	{
+		return Ptr.IsValid();
+	}
+
+	FORCEINLINE TKeyedArrayValueIndexBase<KeyType, ValueType>* operator->() const
+	{
+		return Ptr.Get();
+	}
+};
@@ -1,14 +1,20 @@
 ﻿#pragma once
 
 #include "CoreTypes.h"
-#include "InternalKeyedArray.h"
+#include "KeyedArrayBody.h"
+#include "FrozenKeyedArray.h"
+#include "SoAKeyedArray.h"
+#include "KeyedArrayChangeSet.h"
+#include "KeyedArrayComponent.h"
+#include "KeyedArrayMath.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Serialization/FastArraySerializer.h"
 #include "NameFloatKeyedArray.generated.h"
 
 
 USTRUCT(BlueprintType)
-struct FNameFloatPair
+struct FNameFloatPair : public FFastArraySerializerItem
 {
 	GENERATED_BODY()
 		
@@ -18,413 +24,260 @@ struct FNameFloatPair
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float Value;
 
-	FNameFloatPair()
-	{
-		Key = FName();
-		Value = 0;
-	}
-
-	FNameFloatPair(FName NewKey, float NewValue)
-	{
-		Key = NewKey;
-		Value = NewValue;
-	}
+	KEYED_ARRAY_PAIR_BODY(FNameFloatPair, FName, float)
 };
 
+KEYED_ARRAY_PAIR_TYPE_TRAITS(FNameFloatPair)
+
+/** Storage with the keys and values in separate arrays. Not replicated, see TSoAKeyedArray. */
+typedef TSoAKeyedArray<FName, float, FNameFloatPair> FNameFloatSoAKeyedArray;
+
+/** Flat translator, see TKeyedArrayFlatMap. */
+typedef TKeyedArrayFlatMap<FName, FNameFloatPair> FNameFloatKeyedArrayMap;
+
 
+/**
+ * Replicated as a Fast Array, so only the pairs that were added, changed or removed are sent.
+ * Clients patch their map from the replication callbacks instead of rebuilding it.
+ *
+ * The mutating methods mark the affected pairs dirty. If you modify a value through a reference instead
+ * (i.e. operator[] or GetAsPointer), call MarkKeyDirty or MarkIndexDirty afterwards or it won't be replicated.
+ */
 USTRUCT(BlueprintType)
-struct FNameFloatKeyedArray
+struct FNameFloatKeyedArray : public FFastArraySerializer
 {
 	GENERATED_BODY()
 
-public:
-	typedef FName KeyType;
-	typedef float ValueType;
-	typedef FNameFloatPair PairType;
+	KEYED_ARRAY_BODY_WITH_MAP(FNameFloatKeyedArray, FName, float, FNameFloatPair, FNameFloatKeyedArrayMap)
+
+	KEYED_ARRAY_FLOAT_AGGREGATES()
 
 protected:
-	TInternalKeyedArray<KeyType, ValueType, PairType> Internal;
-	
 	UPROPERTY(EditAnywhere)
 	TArray<FNameFloatPair> BackingPairs;
-	
-	TMap<KeyType, int32> Translator;
-	
-public:
-	FNameFloatKeyedArray()
-	{
-		Internal = TInternalKeyedArray<KeyType, ValueType, PairType>(&BackingPairs, &Translator);
-	}
 
-public:
-	/** Call this whenever the array is modified on clients (i.e. OnRep_KeyedArray).
-	 *  It ensures the Map responsible for allowing key-based access is always up-to-date.
+	/**
+	 * When enabled, Remove and RemoveAt move the last pair into the removed slot instead of shifting every pair
+	 * after it. This makes removals O(1) but doesn't preserve the order of the pairs.
 	 */
-	bool Clean()
-	{
-		// I am not sure how expensive it is to empty a map and rebuild but alternate solutions require quite a bit
-		// of looping and I feel like that looping may end up being significantly more expensive.
-
-		// Under normal circumstances, it will usually be the values that change, not the keys.
-		
-		// Don't bother rebuilding if they keys haven't changed.
-		if (Translator.Num() == BackingPairs.Num())
-		{
-			for (int32 i = 0; i < BackingPairs.Num(); i++)
-			{
-				KeyType Key = BackingPairs[i].Key;
-				if (Translator.Contains(Key))
-				{
-					if (Translator[Key] != i)
-					{
-						// Index for key has changed = dirty.
-						Rebuild();
-						return true;
-					}
-				}
-				else
-				{
-					// Key cannot be found = new = dirty.
-					Rebuild();
-					return true;
-				}
-			}
-
-			return false;
-		}
-
-		Rebuild();
-		return true;
-	}
+	UPROPERTY(EditAnywhere, NotReplicated)
+	bool bSwapOnRemove;
 
 	/**
-	 * Forcefully refreshes the map based entirely on the array data. This is expensive as it's O(n).
+	 * Structural version of the array, bumped when a key is added, removed or moved, and when the pairs are loaded
+	 * or swapped for pooled storage. Lets Clean skip checking every key when only values have changed.
+	 * A local counter that is neither saved nor replicated: clients bump their own from the Fast Array callbacks.
+	 * Pairs replicated as a regular property (i.e. nested in another struct) don't bump it, so Rebuild after those.
 	 */
-	void Rebuild()
-	{
-		Translator.Empty(BackingPairs.Num());
-
-		for (int32 i = 0; i < BackingPairs.Num(); i++)
-		{
-			Translator.Add(BackingPairs[i].Key, i);
-		}
-	}
-
-	
-public:
-	FORCEINLINE int32 Add(const KeyType Key, ValueType&& Item)
-	{
-		return Internal.Add(Key, Item);
-	}
-
-	FORCEINLINE int32 Add(const KeyType Key, const ValueType& Item)
-	{
-		return Internal.Add(Key, Item);
-	}
-	
-	FORCEINLINE int32 Emplace(const KeyType Key, ValueType Item)
-	{
-		return Internal.Emplace(Key, Item);
-	}
-
-	FORCEINLINE int32 EmplaceAt(const KeyType Key, ValueType Item, int32 Index)
-	{
-		return Internal.EmplaceAt(Key, Item, Index);
-	}
-	
-
-	FORCEINLINE int32 Insert(const KeyType Key, const ValueType& Item, int32 Index)
-	{
-		return Internal.Insert(Key, Item, Index);
-	}
-
-	FORCEINLINE bool Remove(const KeyType Key)
-	{
-		return Internal.Remove(Key);
-	}
-
-	FORCEINLINE int32 RemoveFirst(const ValueType& Item)
-	{
-		for (int32 i = 0; i < Num(); i++)
-		{
-			if (BackingPairs[i].Value == Item)
-			{
-				RemoveAt(i);
-				return i;
-			}
-		}
-
-		return -1;
-	}
-
-	FORCEINLINE int32 RemoveAll(const ValueType& Item)
-	{
-		int32 Removals = 0;
-		for (int32 i = Num(); i > 0; i--)
-		{
-			if (BackingPairs[i].Value == Item)
-			{
-				RemoveAt(i);
-				Removals++;
-			}
-		}
-
-		return Removals;
-	}
-
-	FORCEINLINE bool RemoveAt(int32 Index)
-	{
-		return Internal.RemoveAt(Index);
-	}
-	
-
-	FORCEINLINE PairType& GetPair(int32 Index)
-	{
-		return Internal[Index];
-	}
-
-	FORCEINLINE const PairType& GetPair(int32 Index) const
-	{
-		return Internal[Index];
-	}
-
-	FORCEINLINE PairType& GetPair(KeyType Key)
-	{
-		return Internal[Key];
-	}
-
-	FORCEINLINE const PairType& GetPair(KeyType Key) const
-	{
-		return Internal[Key];
-	}
+	UPROPERTY(Transient, NotReplicated)
+	uint32 KeyGeneration;
 
 	/**
-	 * Returns a copy so should only be used for small data types.
+	 * How the values are replicated, i.e. in 14 bits rather than 32 for stats between 0 and 100 with 0.01 precision.
+	 * The server keeps the exact values while clients get them dequantized. Not replicated itself, so it has to be
+	 * the same on the server and clients.
 	 */
-	FORCEINLINE ValueType GetSafe(KeyType Key) const
-	{
-		const ValueType* Value = GetAsPointer(Key);
-		if (Value)
-			return *Value;
+	UPROPERTY(EditAnywhere, NotReplicated)
+	FKeyedArrayNetQuantization NetQuantization;
+};
 
-		return ValueType();
-	}
+KEYED_ARRAY_TYPE_TRAITS(FNameFloatKeyedArray)
 
-	FORCEINLINE ValueType& operator[](KeyType Key)
-	{
-		return GetPair(Key).Value;
-	}
+/**
+ * Read-only version of FNameFloatKeyedArray for tables that never change once filled, i.e. from data assets.
+ * A minimal perfect hash of the keys is saved along with the pairs, but since hashing FNames stably means hashing
+ * their string, lookups go through an index rebuilt from the regular FName hash after loading. Not replicated.
+ */
+USTRUCT(BlueprintType)
+struct FNameFloatFrozenKeyedArray
+{
+	GENERATED_BODY()
 
-	FORCEINLINE const ValueType& operator[](KeyType Key) const
-	{
-		return GetPair(Key).Value;
-	}
+	FROZEN_KEYED_ARRAY_BODY(FNameFloatFrozenKeyedArray, FName, float, FNameFloatPair, FNameFloatKeyedArray)
 
-	FORCEINLINE ValueType& operator[](int32 Index)
-	{
-		return GetPair(Index).Value;
-	}
+protected:
+	UPROPERTY(VisibleAnywhere)
+	TArray<FNameFloatPair> Pairs;
 
-	FORCEINLINE const ValueType& operator[](int32 Index) const
-	{
-		return GetPair(Index).Value;
-	}
+	UPROPERTY()
+	TArray<uint32> Seeds;
 
-	FORCEINLINE ValueType* GetAsPointer(KeyType Key)
-	{
-		PairType* Pair = Internal.GetPairAsPointer(Key);
-		if (Pair)
-			return &Pair->Value;
-		
-		return nullptr;
-	}
+	UPROPERTY()
+	TArray<int32> Slots;
+};
 
-	FORCEINLINE ValueType* GetAsPointer(int32 Index)
-	{
-		PairType* Pair = Internal.GetPairAsPointer(Index);
-        if (Pair)
-        	return &Pair->Value;
-        
-        return nullptr;
-	}
+FROZEN_KEYED_ARRAY_TYPE_TRAITS(FNameFloatFrozenKeyedArray)
 
-	FORCEINLINE const ValueType* GetAsPointer(KeyType Key) const
-	{
-		const PairType* Pair = Internal.GetPairAsPointer(Key);
-		if (Pair)
-			return &Pair->Value;
-		
-		return nullptr;
-	}
+/**
+ *  The Blueprint Function Library required for the Keyed Array to be accessed through Blueprints.
+ */
+UCLASS()
+class UNameFloatKALibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
 
-	FORCEINLINE const ValueType* GetAsPointer(int32 Index) const
+public:
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static float Get(const FNameFloatKeyedArray& Class, const FName Key)
 	{
-		const PairType* Pair = Internal.GetPairAsPointer(Index);
-		if (Pair)
-			return &Pair->Value;
-        
-		return nullptr;
+		return Class.GetSafe(Key);
 	}
 
-	FORCEINLINE int32 Num() const
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static bool Contains(const FNameFloatKeyedArray& Class, const FName Key)
 	{
-		return BackingPairs.Num();
+		return Class.Contains(Key);
 	}
 
-	FORCEINLINE bool Contains(KeyType Key) const
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static int32 Num(const FNameFloatKeyedArray& Class)
 	{
-		return Translator.Contains(Key);
+		return Class.Num();
 	}
 
-	FORCEINLINE bool Contains(const ValueType& Item) const
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static TArray<FNameFloatPair> GetData(const FNameFloatKeyedArray& Class)
 	{
-		return GetFirstIndex(Item) > -1;
+		return Class.GetData();
 	}
 
-	FORCEINLINE int32 GetFirstIndex(const ValueType& Item) const
+	/** Builds a new TMap from the pairs on every call, use Get or Contains to look keys up. */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static TMap<FName, int> GetMap(const FNameFloatKeyedArray& Class)
 	{
-		for (int32 i = 0; i < BackingPairs.Num(); i++)
-			if (BackingPairs[i].Value == Item)
-				return i;
-
-		return -1;
+		return Class.GetTranslatorAsMap();
 	}
 
-	FORCEINLINE KeyType GetFirstKey(const ValueType& Item) const
+	UFUNCTION(BlueprintCallable)
+	static int32 Add(const FNameFloatKeyedArray& Class, const FName Key, float Item)
 	{
-		const KeyType* FirstKey = FindFirstKey(Item);
-		if (FirstKey)
-			return *FirstKey;
-
-		return KeyType();
+		return const_cast<FNameFloatKeyedArray&>(Class).Add(Key, Item);
 	}
 
-	FORCEINLINE const KeyType* FindFirstKey(const ValueType& Item) const
+	UFUNCTION(BlueprintCallable)
+	static int32 Emplace(const FNameFloatKeyedArray& Class, const FName Key, float Item)
 	{
-		for (int32 i = 0; i < BackingPairs.Num(); i++)
-			if (BackingPairs[i].Value == Item)
-				return &BackingPairs[i].Key;
-
-		return nullptr;
+		return const_cast<FNameFloatKeyedArray&>(Class).Emplace(Key, Item);
 	}
 
-	FORCEINLINE const KeyType* GetKey(int32 Index) const
+	UFUNCTION(BlueprintCallable)
+	static bool Remove(const FNameFloatKeyedArray& Class, const FName Key)
 	{
-		return Internal.GetKey(Index);
+		return const_cast<FNameFloatKeyedArray&>(Class).Remove(Key);
 	}
 
-	FORCEINLINE KeyType GetKey(int32 Index)
+	UFUNCTION(BlueprintCallable)
+	static bool RemoveAt(const FNameFloatKeyedArray& Class, int32 Index)
 	{
-		return *Internal.GetKey(Index);
+		return const_cast<FNameFloatKeyedArray&>(Class).RemoveAt(Index);
 	}
 
-	FORCEINLINE bool IsValidIndex(int32 Index) const
-	{
-		return BackingPairs.IsValidIndex(Index);
-	}
-	
-	FORCEINLINE ValueType& Last(int32 IndexFromTheEnd = 0)
+	UFUNCTION(BlueprintCallable)
+	static int32 Append(const FNameFloatKeyedArray& Class, const TArray<FNameFloatPair>& Pairs)
 	{
-		return LastPair(IndexFromTheEnd).Value;
+		return const_cast<FNameFloatKeyedArray&>(Class).Append(Pairs);
 	}
 
-	FORCEINLINE const ValueType& Last(int32 IndexFromTheEnd = 0) const
+	UFUNCTION(BlueprintCallable)
+	static int32 AddMany(const FNameFloatKeyedArray& Class, const TArray<FName>& Keys, const TArray<float>& Items)
 	{
-		return LastPair(IndexFromTheEnd).Value;
+		if (Keys.Num() != Items.Num())
+			return 0;
+		
+		return const_cast<FNameFloatKeyedArray&>(Class).AddMany(Keys, Items);
 	}
 
-	FORCEINLINE PairType& LastPair(int32 IndexFromTheEnd = 0)
+	UFUNCTION(BlueprintCallable)
+	static int32 RemoveMany(const FNameFloatKeyedArray& Class, const TArray<FName>& Keys)
 	{
-		return Internal.Last(IndexFromTheEnd);
+		return const_cast<FNameFloatKeyedArray&>(Class).RemoveMany(Keys);
 	}
 
-	FORCEINLINE const PairType& LastPair(int32 IndexFromTheEnd = 0) const
+	/** Copies the Keyed Array into a read-only one with faster lookups. */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static FNameFloatFrozenKeyedArray Freeze(const FNameFloatKeyedArray& Class)
 	{
-		return Internal.Last(IndexFromTheEnd);
+		return FNameFloatFrozenKeyedArray(Class);
 	}
 
-	FORCEINLINE void Empty(int32 AllocatedElements = 0)
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static float GetFrozen(const FNameFloatFrozenKeyedArray& Frozen, const FName Key)
 	{
-		Internal.Empty(AllocatedElements);
+		return Frozen.GetSafe(Key);
 	}
 
-	FORCEINLINE const TArray<PairType>& GetData() const
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static bool ContainsFrozen(const FNameFloatFrozenKeyedArray& Frozen, const FName Key)
 	{
-		return BackingPairs;
+		return Frozen.Contains(Key);
 	}
 
-	FORCEINLINE const TMap<KeyType, int32>& GetTranslator() const
+	UFUNCTION(BlueprintCallable)
+	static void SetValueIndexEnabled(const FNameFloatKeyedArray& Class, bool bEnabled)
 	{
-		return Translator;
+		const_cast<FNameFloatKeyedArray&>(Class).SetValueIndexEnabled(bEnabled);
 	}
 
-	FORCEINLINE const TInternalKeyedArray<KeyType, ValueType, PairType>& GetInternal() const
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static float Sum(const FNameFloatKeyedArray& Class)
 	{
-		return Internal;
+		return Class.Sum();
 	}
-};
-
-/**
- *  The Blueprint Function Library required for the Keyed Array to be accessed through Blueprints.
- */
-UCLASS()
-class UNameFloatKALibrary : public UBlueprintFunctionLibrary
-{
-	GENERATED_BODY()
 
-public:
 	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static float Get(const FNameFloatKeyedArray& Class, const FName Key)
+	static float Average(const FNameFloatKeyedArray& Class)
 	{
-		return Class.GetSafe(Key);
+		return Class.Average();
 	}
 
+	/** Returns 0 and None if the Keyed Array is empty. */
 	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static bool Contains(const FNameFloatKeyedArray& Class, const FName Key)
+	static float MinValue(const FNameFloatKeyedArray& Class, FName& Key)
 	{
-		return Class.Contains(Key);
+		return GetAt(Class, Class.GetMinIndex(), Key);
 	}
 
+	/** Returns 0 and None if the Keyed Array is empty. */
 	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static int32 Num(const FNameFloatKeyedArray& Class)
+	static float MaxValue(const FNameFloatKeyedArray& Class, FName& Key)
 	{
-		return Class.Num();
+		return GetAt(Class, Class.GetMaxIndex(), Key);
 	}
 
 	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static TArray<FNameFloatPair> GetData(const FNameFloatKeyedArray& Class)
+	static int32 CountWhere(const FNameFloatKeyedArray& Class, EKeyedArrayCompareOp Op, float Threshold)
 	{
-		return Class.GetData();
+		return Class.CountWhere(Op, Threshold);
 	}
 
-	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static TMap<FName, int> GetMap(const FNameFloatKeyedArray& Class)
+	UFUNCTION(BlueprintCallable)
+	static void ScaleAll(const FNameFloatKeyedArray& Class, float Scale)
 	{
-		return Class.GetTranslator();
+		const_cast<FNameFloatKeyedArray&>(Class).ScaleAll(Scale);
 	}
 
 	UFUNCTION(BlueprintCallable)
-	static int32 Add(const FNameFloatKeyedArray& Class, const FName Key, float Item)
+	static int32 RemoveFirst(const FNameFloatKeyedArray& Class, float Item)
 	{
-		return const_cast<FNameFloatKeyedArray&>(Class).Add(Key, Item);
+		return const_cast<FNameFloatKeyedArray&>(Class).RemoveFirst(Item);
 	}
 
 	UFUNCTION(BlueprintCallable)
-	static int32 Emplace(const FNameFloatKeyedArray& Class, const FName Key, float Item)
+	static int32 RemoveAll(const FNameFloatKeyedArray& Class, float Item)
 	{
-		return const_cast<FNameFloatKeyedArray&>(Class).Emplace(Key, Item);
+		return const_cast<FNameFloatKeyedArray&>(Class).RemoveAll(Item);
 	}
 
 	UFUNCTION(BlueprintCallable)
-	static bool Remove(const FNameFloatKeyedArray& Class, const FName Key)
+	static bool RemoveSwap(const FNameFloatKeyedArray& Class, const FName Key)
 	{
-		return const_cast<FNameFloatKeyedArray&>(Class).Remove(Key);
+		return const_cast<FNameFloatKeyedArray&>(Class).RemoveSwap(Key);
 	}
 
 	UFUNCTION(BlueprintCallable)
-	static bool RemoveAt(const FNameFloatKeyedArray& Class, int32 Index)
+	static bool RemoveAtSwap(const FNameFloatKeyedArray& Class, int32 Index)
 	{
-		return const_cast<FNameFloatKeyedArray&>(Class).RemoveAt(Index);
+		return const_cast<FNameFloatKeyedArray&>(Class).RemoveAtSwap(Index);
 	}
 
 	UFUNCTION(BlueprintCallable, BlueprintPure)
@@ -450,6 +303,20 @@ public:
 	{
 		const_cast<FNameFloatKeyedArray&>(Class).Empty(AllocatedElements);
 	}
+
+private:
+	static float GetAt(const FNameFloatKeyedArray& Class, int32 Index, FName& Key)
+	{
+		if (Index < 0)
+		{
+			Key = NAME_None;
+			return 0.f;
+		}
+
+		const FNameFloatPair& Pair = Class.GetPair(Index);
+		Key = Pair.Key;
+		return Pair.Value;
+	}
 };
 
 
@@ -459,9 +326,14 @@ public:
  *  
  *  You do not have to use this component. You can copy how this is implemented to implement replicated Keyed Arrays
  *  as you wish.
+ *
+ *  The Keyed Array is replicated as a Fast Array, so clients only receive the pairs that changed. Removed pairs get
+ *  swapped out by the last pair, which means the order on clients doesn't match the server's: indices, GetKey(Index),
+ *  Last and GetData may differ between the two, and Insert/EmplaceAt ensure they aren't called on a client's copy.
+ *  Use keys to refer to pairs across the network.
  */
 UCLASS( ClassGroup=(KeyedArray), meta=(BlueprintSpawnableComponent) )
-class UNameFloatKAComponent : public UActorComponent
+class UNameFloatKAComponent : public UKeyedArrayComponent
 {
 	GENERATED_BODY()
 
@@ -477,10 +349,34 @@ private:
 	UFUNCTION()
 	void OnRep_KeyedArray();
 
+	/** Copy of the translator handed out by GetMap, rebuilt once the KeyGeneration or the number of pairs changes. */
+	TMap<FName, int> CachedMap;
+
+	uint32 CachedMapKeyGeneration;
+
+protected:
+	virtual void FlushChanges(const FKeyedArrayChangeSet& ChangeSet) override;
+
+	virtual void MarkKeyedArrayDirty() override;
+
+	virtual void MarkKeyedArrayPropertyDirty() override;
+
+	virtual SIZE_T GetKeyedArrayAllocatedSize() const override;
+
+	virtual SIZE_T GetKeyedArraySlackSize() const override;
+
+	virtual void AcquireStorage(UKeyedArrayStoragePool& Pool) override;
+
+	virtual void ReleaseStorage(UKeyedArrayStoragePool& Pool) override;
+
 public:
 	DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FNameFloatKeyedArrayChangedSignature,
 		const FNameFloatKeyedArray&, NewKeyedArray);
 	
+	/**
+	 * Broadcast after every modification on the server, and on clients after every replicated update, even one that
+	 * only changed a single value. Use OnKeyedArrayKeysChanged to know which keys changed.
+	 */
 	UPROPERTY(BlueprintCallable, BlueprintAssignable)
 	FNameFloatKeyedArrayChangedSignature OnKeyedArrayChanged;
 
@@ -504,6 +400,7 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	const TArray<FNameFloatPair>& GetData();
 
+	/** Cached, so only the first call after keys were added, removed or moved has to copy the translator. */
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	const TMap<FName, int>& GetMap();
 
@@ -519,6 +416,27 @@ public:
 	UFUNCTION(BlueprintCallable)
 	bool RemoveAt(int32 Index);
 
+	UFUNCTION(BlueprintCallable)
+	bool RemoveSwap(const FName Key);
+
+	UFUNCTION(BlueprintCallable)
+	int32 RemoveFirst(float Item);
+
+	UFUNCTION(BlueprintCallable)
+	int32 RemoveAll(float Item);
+
+	UFUNCTION(BlueprintCallable)
+	int32 Append(const TArray<FNameFloatPair>& Pairs);
+
+	UFUNCTION(BlueprintCallable)
+	int32 AddMany(const TArray<FName>& Keys, const TArray<float>& Items);
+
+	UFUNCTION(BlueprintCallable)
+	int32 RemoveMany(const TArray<FName>& Keys);
+
+	UFUNCTION(BlueprintCallable)
+	bool RemoveAtSwap(int32 Index);
+
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	FName GetKey(int32 Index);
 
@@ -530,4 +448,18 @@ public:
 
 	UFUNCTION(BlueprintCallable)
 	void Empty(int32 AllocatedElements = 0);
+
+	/** Not replicated; clients can reserve on their own if they know how many pairs to expect. */
+	UFUNCTION(BlueprintCallable)
+	void Reserve(int32 Number);
+
+	UFUNCTION(BlueprintCallable)
+	void Shrink();
+
+	/** Local to this component so it can be enabled on the server and clients independently. */
+	UFUNCTION(BlueprintCallable)
+	void SetValueIndexEnabled(bool bEnabled);
+
+	UFUNCTION(BlueprintCallable)
+	void ScaleAll(float Scale);
 };
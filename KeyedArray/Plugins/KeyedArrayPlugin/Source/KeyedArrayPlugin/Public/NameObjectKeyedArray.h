@@ -1,14 +1,19 @@
 ﻿#pragma once
 
 #include "CoreTypes.h"
-#include "InternalKeyedArray.h"
+#include "KeyedArrayBody.h"
+#include "FrozenKeyedArray.h"
+#include "SoAKeyedArray.h"
+#include "KeyedArrayChangeSet.h"
+#include "KeyedArrayComponent.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Serialization/FastArraySerializer.h"
 #include "NameObjectKeyedArray.generated.h"
 
 
 USTRUCT(BlueprintType)
-struct FNameObjectPair
+struct FNameObjectPair : public FFastArraySerializerItem
 {
 	GENERATED_BODY()
 		
@@ -18,413 +23,232 @@ struct FNameObjectPair
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	UObject* Value;
 
-	FNameObjectPair()
-	{
-		Key = FName();
-		Value = nullptr;
-	}
-
-	FNameObjectPair(FName NewKey, UObject* NewValue)
-	{
-		Key = NewKey;
-		Value = NewValue;
-	}
+	KEYED_ARRAY_PAIR_BODY(FNameObjectPair, FName, UObject*)
 };
 
+KEYED_ARRAY_PAIR_TYPE_TRAITS(FNameObjectPair)
 
-USTRUCT(BlueprintType)
-struct FNameObjectKeyedArray
-{
-	GENERATED_BODY()
+/** Storage with the keys and values in separate arrays. Not replicated, see TSoAKeyedArray. */
+typedef TSoAKeyedArray<FName, UObject*, FNameObjectPair> FNameObjectSoAKeyedArray;
 
-public:
-	typedef FName KeyType;
-	typedef UObject* ValueType;
-	typedef FNameObjectPair PairType;
+/** Flat translator, see TKeyedArrayFlatMap. */
+typedef TKeyedArrayFlatMap<FName, FNameObjectPair> FNameObjectKeyedArrayMap;
 
-protected:
-	TInternalKeyedArray<KeyType, ValueType, PairType> Internal;
-	
-	UPROPERTY(EditAnywhere)
-	TArray<FNameObjectPair> BackingPairs;
-	
-	TMap<KeyType, int32> Translator;
-	
-public:
-	FNameObjectKeyedArray()
-	{
-		Internal = TInternalKeyedArray<KeyType, ValueType, PairType>(&BackingPairs, &Translator);
-	}
 
-public:
-	/** Call this whenever the array is modified on clients (i.e. OnRep_KeyedArray).
-	 *  It ensures the Map responsible for allowing key-based access is always up-to-date.
-	 */
-	bool Clean()
-	{
-		// I am not sure how expensive it is to empty a map and rebuild but alternate solutions require quite a bit
-		// of looping and I feel like that looping may end up being significantly more expensive.
+/**
+ * Replicated as a Fast Array, so only the pairs that were added, changed or removed are sent.
+ * Clients patch their map from the replication callbacks instead of rebuilding it.
+ *
+ * The mutating methods mark the affected pairs dirty. If you modify a value through a reference instead
+ * (i.e. operator[] or GetAsPointer), call MarkKeyDirty or MarkIndexDirty afterwards or it won't be replicated.
+ */
+USTRUCT(BlueprintType)
+struct FNameObjectKeyedArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
 
-		// Under normal circumstances, it will usually be the values that change, not the keys.
-		
-		// Don't bother rebuilding if they keys haven't changed.
-		if (Translator.Num() == BackingPairs.Num())
-		{
-			for (int32 i = 0; i < BackingPairs.Num(); i++)
-			{
-				KeyType Key = BackingPairs[i].Key;
-				if (Translator.Contains(Key))
-				{
-					if (Translator[Key] != i)
-					{
-						// Index for key has changed = dirty.
-						Rebuild();
-						return true;
-					}
-				}
-				else
-				{
-					// Key cannot be found = new = dirty.
-					Rebuild();
-					return true;
-				}
-			}
-
-			return false;
-		}
-
-		Rebuild();
-		return true;
-	}
+	KEYED_ARRAY_BODY_WITH_MAP(FNameObjectKeyedArray, FName, UObject*, FNameObjectPair, FNameObjectKeyedArrayMap)
 
 	/**
-	 * Forcefully refreshes the map based entirely on the array data. This is expensive as it's O(n).
+	 * Removes every pair whose object is null or pending kill (i.e. after garbage collection) in a single pass.
+	 * Returns the number of pairs removed.
+	 * Garbage collection nulls destroyed objects in place, so if the value index is enabled, call this (or
+	 * RebuildValueIndex) afterwards before looking pairs up by a null value.
 	 */
-	void Rebuild()
-	{
-		Translator.Empty(BackingPairs.Num());
-
-		for (int32 i = 0; i < BackingPairs.Num(); i++)
-		{
-			Translator.Add(BackingPairs[i].Key, i);
-		}
-	}
-
-	
-public:
-	FORCEINLINE int32 Add(const KeyType Key, ValueType&& Item)
-	{
-		return Internal.Add(Key, Item);
-	}
-
-	FORCEINLINE int32 Add(const KeyType Key, const ValueType& Item)
-	{
-		return Internal.Add(Key, Item);
-	}
-	
-	FORCEINLINE int32 Emplace(const KeyType Key, ValueType Item)
-	{
-		return Internal.Emplace(Key, Item);
-	}
-
-	FORCEINLINE int32 EmplaceAt(const KeyType Key, ValueType Item, int32 Index)
-	{
-		return Internal.EmplaceAt(Key, Item, Index);
-	}
-	
-
-	FORCEINLINE int32 Insert(const KeyType Key, const ValueType& Item, int32 Index)
-	{
-		return Internal.Insert(Key, Item, Index);
-	}
-
-	FORCEINLINE bool Remove(const KeyType Key)
-	{
-		return Internal.Remove(Key);
-	}
-
-	FORCEINLINE int32 RemoveFirst(const ValueType& Item)
-	{
-		for (int32 i = 0; i < Num(); i++)
-		{
-			if (BackingPairs[i].Value == Item)
-			{
-				RemoveAt(i);
-				return i;
-			}
-		}
-
-		return -1;
-	}
-
-	FORCEINLINE int32 RemoveAll(const ValueType& Item)
+	FORCEINLINE int32 RemoveInvalid(FKeyedArrayChangeSet* OutChanges = nullptr)
 	{
-		int32 Removals = 0;
-		for (int32 i = Num(); i > 0; i--)
+		return RemoveAllMatching([](const PairType& Pair)
 		{
-			if (BackingPairs[i].Value == Item)
-			{
-				RemoveAt(i);
-				Removals++;
-			}
-		}
-
-		return Removals;
-	}
-
-	FORCEINLINE bool RemoveAt(int32 Index)
-	{
-		return Internal.RemoveAt(Index);
-	}
-	
-
-	FORCEINLINE PairType& GetPair(int32 Index)
-	{
-		return Internal[Index];
-	}
-
-	FORCEINLINE const PairType& GetPair(int32 Index) const
-	{
-		return Internal[Index];
-	}
-
-	FORCEINLINE PairType& GetPair(KeyType Key)
-	{
-		return Internal[Key];
+			return !IsValid(Pair.Value);
+		}, OutChanges);
 	}
 
-	FORCEINLINE const PairType& GetPair(KeyType Key) const
-	{
-		return Internal[Key];
-	}
+protected:
+	UPROPERTY(EditAnywhere)
+	TArray<FNameObjectPair> BackingPairs;
 
 	/**
-	 * Returns a copy so should only be used for small data types.
+	 * When enabled, Remove and RemoveAt move the last pair into the removed slot instead of shifting every pair
+	 * after it. This makes removals O(1) but doesn't preserve the order of the pairs.
 	 */
-	FORCEINLINE ValueType GetSafe(KeyType Key) const
-	{
-		const ValueType* Value = GetAsPointer(Key);
-		if (Value)
-			return *Value;
-
-		return ValueType();
-	}
-
-	FORCEINLINE ValueType& operator[](KeyType Key)
-	{
-		return GetPair(Key).Value;
-	}
-
-	FORCEINLINE const ValueType& operator[](KeyType Key) const
-	{
-		return GetPair(Key).Value;
-	}
+	UPROPERTY(EditAnywhere, NotReplicated)
+	bool bSwapOnRemove;
 
-	FORCEINLINE ValueType& operator[](int32 Index)
-	{
-		return GetPair(Index).Value;
-	}
-
-	FORCEINLINE const ValueType& operator[](int32 Index) const
-	{
-		return GetPair(Index).Value;
-	}
-
-	FORCEINLINE ValueType* GetAsPointer(KeyType Key)
-	{
-		PairType* Pair = Internal.GetPairAsPointer(Key);
-		if (Pair)
-			return &Pair->Value;
-		
-		return nullptr;
-	}
+	/**
+	 * Structural version of the array, bumped when a key is added, removed or moved, and when the pairs are loaded
+	 * or swapped for pooled storage. Lets Clean skip checking every key when only values have changed.
+	 * A local counter that is neither saved nor replicated: clients bump their own from the Fast Array callbacks.
+	 * Pairs replicated as a regular property (i.e. nested in another struct) don't bump it, so Rebuild after those.
+	 */
+	UPROPERTY(Transient, NotReplicated)
+	uint32 KeyGeneration;
+};
 
-	FORCEINLINE ValueType* GetAsPointer(int32 Index)
-	{
-		PairType* Pair = Internal.GetPairAsPointer(Index);
-        if (Pair)
-        	return &Pair->Value;
-        
-        return nullptr;
-	}
+KEYED_ARRAY_TYPE_TRAITS(FNameObjectKeyedArray)
 
-	FORCEINLINE const ValueType* GetAsPointer(KeyType Key) const
-	{
-		const PairType* Pair = Internal.GetPairAsPointer(Key);
-		if (Pair)
-			return &Pair->Value;
-		
-		return nullptr;
-	}
+/**
+ * Read-only version of FNameObjectKeyedArray for tables that never change once filled, i.e. from data assets.
+ * A minimal perfect hash of the keys is saved along with the pairs, but since hashing FNames stably means hashing
+ * their string, lookups go through an index rebuilt from the regular FName hash after loading. Not replicated.
+ */
+USTRUCT(BlueprintType)
+struct FNameObjectFrozenKeyedArray
+{
+	GENERATED_BODY()
 
-	FORCEINLINE const ValueType* GetAsPointer(int32 Index) const
-	{
-		const PairType* Pair = Internal.GetPairAsPointer(Index);
-		if (Pair)
-			return &Pair->Value;
-        
-		return nullptr;
-	}
+	FROZEN_KEYED_ARRAY_BODY(FNameObjectFrozenKeyedArray, FName, UObject*, FNameObjectPair, FNameObjectKeyedArray)
 
-	FORCEINLINE int32 Num() const
-	{
-		return BackingPairs.Num();
-	}
+protected:
+	UPROPERTY(VisibleAnywhere)
+	TArray<FNameObjectPair> Pairs;
 
-	FORCEINLINE bool Contains(KeyType Key) const
-	{
-		return Translator.Contains(Key);
-	}
+	UPROPERTY()
+	TArray<uint32> Seeds;
 
-	FORCEINLINE bool Contains(const ValueType& Item) const
-	{
-		return GetFirstIndex(Item) > -1;
-	}
+	UPROPERTY()
+	TArray<int32> Slots;
+};
 
-	FORCEINLINE int32 GetFirstIndex(const ValueType& Item) const
-	{
-		for (int32 i = 0; i < BackingPairs.Num(); i++)
-			if (BackingPairs[i].Value == Item)
-				return i;
+FROZEN_KEYED_ARRAY_TYPE_TRAITS(FNameObjectFrozenKeyedArray)
 
-		return -1;
-	}
+/**
+ *  The Blueprint Function Library required for the Keyed Array to be accessed through Blueprints.
+ */
+UCLASS()
+class UNameObjectKALibrary : public UBlueprintFunctionLibrary
+{
+	GENERATED_BODY()
 
-	FORCEINLINE KeyType GetFirstKey(const ValueType& Item) const
+public:
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static UObject* Get(const FNameObjectKeyedArray& Class, const FName Key)
 	{
-		const KeyType* FirstKey = FindFirstKey(Item);
-		if (FirstKey)
-			return *FirstKey;
-
-		return KeyType();
+		return Class.GetSafe(Key);
 	}
 
-	FORCEINLINE const KeyType* FindFirstKey(const ValueType& Item) const
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static bool Contains(const FNameObjectKeyedArray& Class, const FName Key)
 	{
-		for (int32 i = 0; i < BackingPairs.Num(); i++)
-			if (BackingPairs[i].Value == Item)
-				return &BackingPairs[i].Key;
-
-		return nullptr;
+		return Class.Contains(Key);
 	}
 
-	FORCEINLINE const KeyType* GetKey(int32 Index) const
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static int32 Num(const FNameObjectKeyedArray& Class)
 	{
-		return Internal.GetKey(Index);
+		return Class.Num();
 	}
 
-	FORCEINLINE KeyType GetKey(int32 Index)
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static TArray<FNameObjectPair> GetData(const FNameObjectKeyedArray& Class)
 	{
-		return *Internal.GetKey(Index);
+		return Class.GetData();
 	}
 
-	FORCEINLINE bool IsValidIndex(int32 Index) const
-	{
-		return BackingPairs.IsValidIndex(Index);
-	}
-	
-	FORCEINLINE ValueType& Last(int32 IndexFromTheEnd = 0)
+	/** Builds a new TMap from the pairs on every call, use Get or Contains to look keys up. */
+	UFUNCTION(BlueprintCallable, BlueprintPure)
+	static TMap<FName, int> GetMap(const FNameObjectKeyedArray& Class)
 	{
-		return LastPair(IndexFromTheEnd).Value;
+		return Class.GetTranslatorAsMap();
 	}
 
-	FORCEINLINE const ValueType& Last(int32 IndexFromTheEnd = 0) const
+	UFUNCTION(BlueprintCallable)
+	static int32 Add(const FNameObjectKeyedArray& Class, const FName Key, UObject* Item)
 	{
-		return LastPair(IndexFromTheEnd).Value;
+		return const_cast<FNameObjectKeyedArray&>(Class).Add(Key, Item);
 	}
 
-	FORCEINLINE PairType& LastPair(int32 IndexFromTheEnd = 0)
+	UFUNCTION(BlueprintCallable)
+	static int32 Emplace(const FNameObjectKeyedArray& Class, const FName Key, UObject* Item)
 	{
-		return Internal.Last(IndexFromTheEnd);
+		return const_cast<FNameObjectKeyedArray&>(Class).Emplace(Key, Item);
 	}
 
-	FORCEINLINE const PairType& LastPair(int32 IndexFromTheEnd = 0) const
+	UFUNCTION(BlueprintCallable)
+	static bool Remove(const FNameObjectKeyedArray& Class, const FName Key)
 	{
-		return Internal.Last(IndexFromTheEnd);
+		return const_cast<FNameObjectKeyedArray&>(Class).Remove(Key);
 	}
 
-	FORCEINLINE void Empty(int32 AllocatedElements = 0)
+	UFUNCTION(BlueprintCallable)
+	static bool RemoveAt(const FNameObjectKeyedArray& Class, int32 Index)
 	{
-		Internal.Empty(AllocatedElements);
+		return const_cast<FNameObjectKeyedArray&>(Class).RemoveAt(Index);
 	}
 
-	FORCEINLINE const TArray<PairType>& GetData() const
+	UFUNCTION(BlueprintCallable)
+	static int32 Append(const FNameObjectKeyedArray& Class, const TArray<FNameObjectPair>& Pairs)
 	{
-		return BackingPairs;
+		return const_cast<FNameObjectKeyedArray&>(Class).Append(Pairs);
 	}
 
-	FORCEINLINE const TMap<KeyType, int32>& GetTranslator() const
+	UFUNCTION(BlueprintCallable)
+	static int32 AddMany(const FNameObjectKeyedArray& Class, const TArray<FName>& Keys, const TArray<UObject*>& Items)
 	{
-		return Translator;
+		if (Keys.Num() != Items.Num())
+			return 0;
+		
+		return const_cast<FNameObjectKeyedArray&>(Class).AddMany(Keys, Items);
 	}
 
-	FORCEINLINE const TInternalKeyedArray<KeyType, ValueType, PairType>& GetInternal() const
+	UFUNCTION(BlueprintCallable)
+	static int32 RemoveMany(const FNameObjectKeyedArray& Class, const TArray<FName>& Keys)
 	{
-		return Internal;
+		return const_cast<FNameObjectKeyedArray&>(Class).RemoveMany(Keys);
 	}
-};
-
-/**
- *  The Blueprint Function Library required for the Keyed Array to be accessed through Blueprints.
- */
-UCLASS()
-class UNameObjectKALibrary : public UBlueprintFunctionLibrary
-{
-	GENERATED_BODY()
 
-public:
+	/** Copies the Keyed Array into a read-only one with faster lookups. */
 	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static UObject* Get(const FNameObjectKeyedArray& Class, const FName Key)
+	static FNameObjectFrozenKeyedArray Freeze(const FNameObjectKeyedArray& Class)
 	{
-		return Class.GetSafe(Key);
+		return FNameObjectFrozenKeyedArray(Class);
 	}
 
 	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static bool Contains(const FNameObjectKeyedArray& Class, const FName Key)
+	static UObject* GetFrozen(const FNameObjectFrozenKeyedArray& Frozen, const FName Key)
 	{
-		return Class.Contains(Key);
+		return Frozen.GetSafe(Key);
 	}
 
 	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static int32 Num(const FNameObjectKeyedArray& Class)
+	static bool ContainsFrozen(const FNameObjectFrozenKeyedArray& Frozen, const FName Key)
 	{
-		return Class.Num();
+		return Frozen.Contains(Key);
 	}
 
-	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static TArray<FNameObjectPair> GetData(const FNameObjectKeyedArray& Class)
+	UFUNCTION(BlueprintCallable)
+	static void SetValueIndexEnabled(const FNameObjectKeyedArray& Class, bool bEnabled)
 	{
-		return Class.GetData();
+		const_cast<FNameObjectKeyedArray&>(Class).SetValueIndexEnabled(bEnabled);
 	}
 
-	UFUNCTION(BlueprintCallable, BlueprintPure)
-	static TMap<FName, int> GetMap(const FNameObjectKeyedArray& Class)
+	UFUNCTION(BlueprintCallable)
+	static int32 RemoveFirst(const FNameObjectKeyedArray& Class, UObject* Item)
 	{
-		return Class.GetTranslator();
+		return const_cast<FNameObjectKeyedArray&>(Class).RemoveFirst(Item);
 	}
 
 	UFUNCTION(BlueprintCallable)
-	static int32 Add(const FNameObjectKeyedArray& Class, const FName Key, UObject* Item)
+	static int32 RemoveAll(const FNameObjectKeyedArray& Class, UObject* Item)
 	{
-		return const_cast<FNameObjectKeyedArray&>(Class).Add(Key, Item);
+		return const_cast<FNameObjectKeyedArray&>(Class).RemoveAll(Item);
 	}
 
 	UFUNCTION(BlueprintCallable)
-	static int32 Emplace(const FNameObjectKeyedArray& Class, const FName Key, UObject* Item)
+	static int32 RemoveInvalid(const FNameObjectKeyedArray& Class)
 	{
-		return const_cast<FNameObjectKeyedArray&>(Class).Emplace(Key, Item);
+		return const_cast<FNameObjectKeyedArray&>(Class).RemoveInvalid();
 	}
 
 	UFUNCTION(BlueprintCallable)
-	static bool Remove(const FNameObjectKeyedArray& Class, const FName Key)
+	static bool RemoveSwap(const FNameObjectKeyedArray& Class, const FName Key)
 	{
-		return const_cast<FNameObjectKeyedArray&>(Class).Remove(Key);
+		return const_cast<FNameObjectKeyedArray&>(Class).RemoveSwap(Key);
 	}
 
 	UFUNCTION(BlueprintCallable)
-	static bool RemoveAt(const FNameObjectKeyedArray& Class, int32 Index)
+	static bool RemoveAtSwap(const FNameObjectKeyedArray& Class, int32 Index)
 	{
-		return const_cast<FNameObjectKeyedArray&>(Class).RemoveAt(Index);
+		return const_cast<FNameObjectKeyedArray&>(Class).RemoveAtSwap(Index);
 	}
 
 	UFUNCTION(BlueprintCallable, BlueprintPure)
@@ -459,9 +283,14 @@ public:
  *  
  *  You do not have to use this component. You can copy how this is implemented to implement replicated Keyed Arrays
  *  as you wish.
+ *
+ *  The Keyed Array is replicated as a Fast Array, so clients only receive the pairs that changed. Removed pairs get
+ *  swapped out by the last pair, which means the order on clients doesn't match the server's: indices, GetKey(Index),
+ *  Last and GetData may differ between the two, and Insert/EmplaceAt ensure they aren't called on a client's copy.
+ *  Use keys to refer to pairs across the network.
  */
 UCLASS( ClassGroup=(KeyedArray), meta=(BlueprintSpawnableComponent) )
-class UNameObjectKAComponent : public UActorComponent
+class UNameObjectKAComponent : public UKeyedArrayComponent
 {
 	GENERATED_BODY()
 
@@ -477,10 +306,34 @@ private:
 	UFUNCTION()
 	void OnRep_KeyedArray();
 
+	/** Copy of the translator handed out by GetMap, rebuilt once the KeyGeneration or the number of pairs changes. */
+	TMap<FName, int> CachedMap;
+
+	uint32 CachedMapKeyGeneration;
+
+protected:
+	virtual void FlushChanges(const FKeyedArrayChangeSet& ChangeSet) override;
+
+	virtual void MarkKeyedArrayDirty() override;
+
+	virtual void MarkKeyedArrayPropertyDirty() override;
+
+	virtual SIZE_T GetKeyedArrayAllocatedSize() const override;
+
+	virtual SIZE_T GetKeyedArraySlackSize() const override;
+
+	virtual void AcquireStorage(UKeyedArrayStoragePool& Pool) override;
+
+	virtual void ReleaseStorage(UKeyedArrayStoragePool& Pool) override;
+
 public:
 	DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FNameObjectKeyedArrayChangedSignature,
 		const FNameObjectKeyedArray&, NewKeyedArray);
 	
+	/**
+	 * Broadcast after every modification on the server, and on clients after every replicated update, even one that
+	 * only changed a single value. Use OnKeyedArrayKeysChanged to know which keys changed.
+	 */
 	UPROPERTY(BlueprintCallable, BlueprintAssignable)
 	FNameObjectKeyedArrayChangedSignature OnKeyedArrayChanged;
 
@@ -504,6 +357,7 @@ public:
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	const TArray<FNameObjectPair>& GetData();
 
+	/** Cached, so only the first call after keys were added, removed or moved has to copy the translator. */
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	const TMap<FName, int>& GetMap();
 
@@ -519,6 +373,30 @@ public:
 	UFUNCTION(BlueprintCallable)
 	bool RemoveAt(int32 Index);
 
+	UFUNCTION(BlueprintCallable)
+	bool RemoveSwap(const FName Key);
+
+	UFUNCTION(BlueprintCallable)
+	int32 RemoveFirst(UObject* Item);
+
+	UFUNCTION(BlueprintCallable)
+	int32 RemoveAll(UObject* Item);
+
+	UFUNCTION(BlueprintCallable)
+	int32 RemoveInvalid();
+
+	UFUNCTION(BlueprintCallable)
+	int32 Append(const TArray<FNameObjectPair>& Pairs);
+
+	UFUNCTION(BlueprintCallable)
+	int32 AddMany(const TArray<FName>& Keys, const TArray<UObject*>& Items);
+
+	UFUNCTION(BlueprintCallable)
+	int32 RemoveMany(const TArray<FName>& Keys);
+
+	UFUNCTION(BlueprintCallable)
+	bool RemoveAtSwap(int32 Index);
+
 	UFUNCTION(BlueprintCallable, BlueprintPure)
 	FName GetKey(int32 Index);
 
@@ -530,4 +408,15 @@ public:
 
 	UFUNCTION(BlueprintCallable)
 	void Empty(int32 AllocatedElements = 0);
+
+	/** Not replicated; clients can reserve on their own if they know how many pairs to expect. */
+	UFUNCTION(BlueprintCallable)
+	void Reserve(int32 Number);
+
+	UFUNCTION(BlueprintCallable)
+	void Shrink();
+
+	/** Local to this component so it can be enabled on the server and clients independently. */
+	UFUNCTION(BlueprintCallable)
+	void SetValueIndexEnabled(bool bEnabled);
 };
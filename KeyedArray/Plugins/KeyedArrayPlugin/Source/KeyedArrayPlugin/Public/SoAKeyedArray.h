@@ -0,0 +1,393 @@
+﻿#pragma once
+
+#include "CoreTypes.h"
+#include "KeyedArrayKeyFuncs.h"
+#include "KeyedArraySmallMap.h"
+#include "KeyedArrayMath.h"
+
+/**
+ * Stands in for a pair of a TSoAKeyedArray, which doesn't store any. Key and Value refer straight into the arrays,
+ * so code written against the pairs (Pair.Key, Pair.Value) keeps working.
+ */
+template<typename KeyType, typename ValueType>
+struct TKeyedArrayPairRef
+{
+	const KeyType& Key;
+	ValueType& Value;
+
+	TKeyedArrayPairRef(const KeyType& InKey, ValueType& InValue)
+		: Key(InKey), Value(InValue)
+	{
+	}
+
+	/** Copies the pair out, i.e. to add it to a replicated Keyed Array. */
+	template<typename PairType>
+	FORCEINLINE PairType ToPair() const
+	{
+		return PairType(Key, Value);
+	}
+};
+
+/**
+ * An alternate storage for Keyed Arrays where the keys and values live in separate arrays (structure of arrays).
+ * Scanning values (i.e. GetFirstIndex, or summing them) only reads the values rather than dragging every key
+ * through the cache along with them. Pairs are accessed through TKeyedArrayPairRef.
+ *
+ * The Fast Array replication needs an array of FFastArraySerializerItems, so this type isn't replicated. Use
+ * AppendPairsTo or ToPairs to hand its content to a replicated Keyed Array, and FromPairs to read one back.
+ *
+ * Not being a UPROPERTY, it can take any allocator and key policy. i.e. TInlineAllocator<8> along with a
+ * TKeyedArraySmallMap<KeyType, 8> stores up to 8 pairs without a single allocation.
+ */
+template<typename KeyType, typename ValueType, typename PairType, typename AllocatorType = FDefaultAllocator, typename MapType = TKeyedArrayMap<KeyType>>
+class TSoAKeyedArray
+{
+	typedef TArray<KeyType, AllocatorType> KeyArrayType;
+	typedef TArray<ValueType, AllocatorType> ValueArrayType;
+	typedef TKeyedArrayPairRef<KeyType, ValueType> PairRefType;
+	typedef TKeyedArrayPairRef<KeyType, const ValueType> ConstPairRefType;
+
+protected:
+	KeyArrayType Keys;
+	ValueArrayType Values;
+	MapType Translator;
+
+public:
+	/** Adds the pair, or updates its value if the key already exists. Returns its index. */
+	FORCEINLINE int32 Add(const KeyType Key, const ValueType& Item)
+	{
+		const int32 NumBefore = Translator.Num();
+		int32& Index = Translator.FindOrAdd(Key);
+		if (Translator.Num() == NumBefore)
+		{
+			Values[Index] = Item;
+			return Index;
+		}
+
+		Index = Keys.Add(Key);
+		Values.Add(Item);
+		return Index;
+	}
+
+	FORCEINLINE int32 Emplace(const KeyType Key, ValueType Item)
+	{
+		const int32 NumBefore = Translator.Num();
+		int32& Index = Translator.FindOrAdd(Key);
+		if (Translator.Num() == NumBefore)
+		{
+			Values[Index] = MoveTemp(Item);
+			return Index;
+		}
+
+		Index = Keys.Add(Key);
+		Values.Emplace(MoveTemp(Item));
+		return Index;
+	}
+
+	/** Preserves the order of the pairs, so every pair after the removed one has its index shifted. */
+	FORCEINLINE bool Remove(const KeyType Key)
+	{
+		int32 Index;
+		if (Translator.RemoveAndCopyValue(Key, Index))
+		{
+			RemoveAtInternal(Index);
+			return true;
+		}
+
+		return false;
+	}
+
+	FORCEINLINE bool RemoveAt(int32 Index)
+	{
+		if (Keys.IsValidIndex(Index))
+		{
+			Translator.Remove(Keys[Index]);
+			RemoveAtInternal(Index);
+			return true;
+		}
+
+		return false;
+	}
+
+	/** Unordered version of Remove. O(1) since only the last pair gets moved. */
+	FORCEINLINE bool RemoveSwap(const KeyType Key)
+	{
+		int32 Index;
+		if (Translator.RemoveAndCopyValue(Key, Index))
+		{
+			RemoveAtSwapInternal(Index);
+			return true;
+		}
+
+		return false;
+	}
+
+	/** Unordered version of RemoveAt. O(1) since only the last pair gets moved. */
+	FORCEINLINE bool RemoveAtSwap(int32 Index)
+	{
+		if (Keys.IsValidIndex(Index))
+		{
+			Translator.Remove(Keys[Index]);
+			RemoveAtSwapInternal(Index);
+			return true;
+		}
+
+		return false;
+	}
+
+	FORCEINLINE int32 GetIndex(const KeyType& Key) const
+	{
+		const int32* Index = Translator.Find(Key);
+		if (Index)
+			return *Index;
+
+		return -1;
+	}
+
+	FORCEINLINE PairRefType GetPair(int32 Index)
+	{
+		return PairRefType(Keys[Index], Values[Index]);
+	}
+
+	FORCEINLINE ConstPairRefType GetPair(int32 Index) const
+	{
+		return ConstPairRefType(Keys[Index], Values[Index]);
+	}
+
+	FORCEINLINE ValueType* GetAsPointer(const KeyType& Key)
+	{
+		const int32* Index = Translator.Find(Key);
+		if (Index)
+			return &Values[*Index];
+
+		return nullptr;
+	}
+
+	FORCEINLINE const ValueType* GetAsPointer(const KeyType& Key) const
+	{
+		const int32* Index = Translator.Find(Key);
+		if (Index)
+			return &Values[*Index];
+
+		return nullptr;
+	}
+
+	/**
+	 * Returns a copy so should only be used for small data types.
+	 */
+	FORCEINLINE ValueType GetSafe(const KeyType& Key) const
+	{
+		const ValueType* Value = GetAsPointer(Key);
+		if (Value)
+			return *Value;
+
+		return ValueType();
+	}
+
+	FORCEINLINE ValueType& operator[](const KeyType& Key)
+	{
+		return Values[Translator.FindChecked(Key)];
+	}
+
+	FORCEINLINE const ValueType& operator[](const KeyType& Key) const
+	{
+		return Values[Translator.FindChecked(Key)];
+	}
+
+	FORCEINLINE bool Contains(const KeyType& Key) const
+	{
+		return Translator.Contains(Key);
+	}
+
+	/** Only reads the values. */
+	FORCEINLINE int32 GetFirstIndex(const ValueType& Item) const
+	{
+		return Values.IndexOfByKey(Item);
+	}
+
+	FORCEINLINE const KeyType* FindFirstKey(const ValueType& Item) const
+	{
+		const int32 Index = GetFirstIndex(Item);
+		if (Index > -1)
+			return &Keys[Index];
+
+		return nullptr;
+	}
+
+	FORCEINLINE int32 Num() const
+	{
+		return Keys.Num();
+	}
+
+	FORCEINLINE void Empty(int32 AllocatedElements = 0)
+	{
+		Keys.Empty(AllocatedElements);
+		Values.Empty(AllocatedElements);
+		Translator.Empty(AllocatedElements);
+	}
+
+	FORCEINLINE void Reserve(int32 Number)
+	{
+		Keys.Reserve(Number);
+		Values.Reserve(Number);
+		Translator.Reserve(Number);
+	}
+
+	FORCEINLINE void Shrink()
+	{
+		Keys.Shrink();
+		Values.Shrink();
+		Translator.Shrink();
+	}
+
+	FORCEINLINE SIZE_T GetAllocatedSize() const
+	{
+		return Keys.GetAllocatedSize() + Values.GetAllocatedSize() + Translator.GetAllocatedSize();
+	}
+
+	/** The keys, in the same order as the values. */
+	FORCEINLINE const KeyArrayType& GetKeys() const
+	{
+		return Keys;
+	}
+
+	/** The values, contiguous so they can be scanned without touching the keys. */
+	FORCEINLINE const ValueArrayType& GetValues() const
+	{
+		return Values;
+	}
+
+	/** Values can be modified freely since that doesn't affect the keys. */
+	FORCEINLINE TArrayView<ValueType> GetMutableValues()
+	{
+		return Values;
+	}
+
+	FORCEINLINE const MapType& GetTranslator() const
+	{
+		return Translator;
+	}
+
+	/** Replaces every pair with the given ones, i.e. the content of a replicated Keyed Array. */
+	void FromPairs(TArrayView<const PairType> Pairs)
+	{
+		Empty(Pairs.Num());
+		for (const PairType& Pair : Pairs)
+			Add(Pair.Key, Pair.Value);
+	}
+
+	/** Copies every pair out in order. */
+	void ToPairs(TArray<PairType>& OutPairs) const
+	{
+		OutPairs.Reset(Num());
+		for (int32 i = 0; i < Num(); i++)
+			OutPairs.Emplace(Keys[i], Values[i]);
+	}
+
+	/**
+	 * Adds every pair to another Keyed Array (i.e. a replicated one), or updates the value if the key already exists.
+	 * Returns the number of keys added.
+	 */
+	template<typename KeyedArrayType>
+	int32 AppendPairsTo(KeyedArrayType& KeyedArray) const
+	{
+		return KeyedArray.AddMany(Keys, Values);
+	}
+
+	/**
+	 * Aggregates over float values. The values being contiguous, these run through FKeyedArrayMath four at a time
+	 * without the gather that KEYED_ARRAY_FLOAT_AGGREGATES does first.
+	 */
+	FORCEINLINE float Sum() const
+	{
+		return FKeyedArrayMath::Sum(Values);
+	}
+
+	FORCEINLINE float Average() const
+	{
+		return FKeyedArrayMath::Average(Values);
+	}
+
+	/** Index of the first smallest value, or -1 if empty. */
+	FORCEINLINE int32 GetMinIndex() const
+	{
+		return FKeyedArrayMath::ArgMin(Values);
+	}
+
+	/** Index of the first largest value, or -1 if empty. */
+	FORCEINLINE int32 GetMaxIndex() const
+	{
+		return FKeyedArrayMath::ArgMax(Values);
+	}
+
+	/** Number of values for which "Value Op Threshold" is true. */
+	FORCEINLINE int32 CountWhere(EKeyedArrayCompareOp Op, float Threshold) const
+	{
+		return FKeyedArrayMath::CountWhere(Values, Op, Threshold);
+	}
+
+	/** Multiplies every value. */
+	FORCEINLINE void ScaleAll(float Scale)
+	{
+		FKeyedArrayMath::Scale(Values, Scale);
+	}
+
+	/** Iterates through TKeyedArrayPairRefs. */
+	template<typename OwnerType, typename RefType>
+	class TBaseIterator
+	{
+		OwnerType& Owner;
+		int32 Index;
+
+	public:
+		TBaseIterator(OwnerType& InOwner, int32 StartIndex)
+			: Owner(InOwner)
+		{
+			Index = StartIndex;
+		}
+
+		FORCEINLINE RefType operator*() const
+		{
+			return Owner.GetPair(Index);
+		}
+
+		FORCEINLINE TBaseIterator& operator++()
+		{
+			Index++;
+			return *this;
+		}
+
+		FORCEINLINE bool operator!=(const TBaseIterator& Other) const
+		{
+			return Index != Other.Index;
+		}
+	};
+
+	typedef TBaseIterator<TSoAKeyedArray, PairRefType> TIterator;
+	typedef TBaseIterator<const TSoAKeyedArray, ConstPairRefType> TConstIterator;
+
+	FORCEINLINE TIterator begin() { return TIterator(*this, 0); }
+	FORCEINLINE TConstIterator begin() const { return TConstIterator(*this, 0); }
+	FORCEINLINE TIterator end() { return TIterator(*this, Num()); }
+	FORCEINLINE TConstIterator end() const { return TConstIterator(*this, Num()); }
+
+protected:
+	FORCEINLINE void RemoveAtInternal(int32 Index)
+	{
+		Keys.RemoveAt(Index);
+		Values.RemoveAt(Index);
+
+		for (int32 i = Index; i < Keys.Num(); i++)
+			Translator.FindChecked(Keys[i]) = i;
+	}
+
+	FORCEINLINE void RemoveAtSwapInternal(int32 Index)
+	{
+		const int32 LastIndex = Keys.Num() - 1;
+		if (Index != LastIndex)
+			Translator.FindChecked(Keys[LastIndex]) = Index;
+
+		Keys.RemoveAtSwap(Index);
+		Values.RemoveAtSwap(Index);
+	}
+};